@@ -0,0 +1,124 @@
+/* Copyright (c) 2024 Jrgen Grahn
+ * All rights reserved.
+ *
+ * Micro-benchmark: the cost of going from an epoll_event to the
+ * handler for its fd, the old way (std::map<int, std::function> keyed
+ * by fd) and the current Spider way (a flat table of inline
+ * Callbacks, pointed to by the event).
+ *
+ * No actual epoll_wait(); the events are generated up front.
+ */
+#include "callback.h"
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <random>
+#include <vector>
+#include <cstdio>
+
+#include <sys/epoll.h>
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    struct Counter {
+	unsigned long n = 0;
+	void read(int fd) { n += fd; }
+    };
+
+    double ns_per(Clock::duration d, unsigned long n)
+    {
+	return std::chrono::duration<double, std::nano>(d).count() / n;
+    }
+
+    std::vector<int> random_fds(unsigned nfd, unsigned n)
+    {
+	std::mt19937 rng {4711};
+	std::uniform_int_distribution<int> dist {3, int(nfd) + 2};
+	std::vector<int> v(n);
+	for (int& fd : v) fd = dist(rng);
+	return v;
+    }
+
+    /* Returns ns per event.
+     */
+    double before(const std::vector<int>& fds, unsigned nfd, unsigned rounds,
+		  Counter& c, double& reg)
+    {
+	std::map<int, std::function<void(int)>> ff;
+
+	auto t0 = Clock::now();
+	for (unsigned fd = 3; fd < nfd + 3; fd++) {
+	    ff[fd] = [&] (int fd) { c.read(fd); };
+	}
+	reg = ns_per(Clock::now() - t0, nfd);
+
+	std::vector<epoll_event> ev(fds.size());
+	for (unsigned i = 0; i < fds.size(); i++) ev[i].data.fd = fds[i];
+
+	t0 = Clock::now();
+	for (unsigned r = 0; r < rounds; r++) {
+	    for (const auto& e : ev) {
+		const int fd = e.data.fd;
+		auto it = ff.find(fd);
+		if (it != end(ff)) it->second(fd);
+	    }
+	}
+	return ns_per(Clock::now() - t0, rounds * ev.size());
+    }
+
+    double after(const std::vector<int>& fds, unsigned nfd, unsigned rounds,
+		 Counter& c, double& reg)
+    {
+	using Handler = Callback<void(int)>;
+	struct Entry {
+	    int fd;
+	    Handler rf;
+	    Handler wf;
+	};
+	std::deque<Entry> ff;
+
+	auto t0 = Clock::now();
+	for (unsigned fd = 3; fd < nfd + 3; fd++) {
+	    while (ff.size() <= fd) ff.push_back({int(ff.size()), {}, {}});
+	    ff[fd].rf = [&] (int fd) { c.read(fd); };
+	}
+	reg = ns_per(Clock::now() - t0, nfd);
+
+	std::vector<epoll_event> ev(fds.size());
+	for (unsigned i = 0; i < fds.size(); i++) ev[i].data.ptr = &ff[fds[i]];
+
+	t0 = Clock::now();
+	for (unsigned r = 0; r < rounds; r++) {
+	    for (const auto& e : ev) {
+		Entry& entry = *static_cast<Entry*>(e.data.ptr);
+		if (entry.rf) entry.rf(entry.fd);
+	    }
+	}
+	return ns_per(Clock::now() - t0, rounds * ev.size());
+    }
+}
+
+int main()
+{
+    std::printf("%8s %14s %14s %14s %14s\n",
+		"fds", "map reg ns", "flat reg ns", "map ns/ev", "flat ns/ev");
+
+    for (unsigned nfd : {10, 100, 1000, 10000, 100000}) {
+	const auto fds = random_fds(nfd, 100000);
+	const unsigned rounds = 50;
+	Counter c;
+	double rb, ra;
+	const double b = before(fds, nfd, rounds, c, rb);
+	const double a = after(fds, nfd, rounds, c, ra);
+	std::printf("%8u %14.1f %14.1f %14.2f %14.2f\n",
+		    nfd, rb, ra, b, a);
+	if (!c.n) std::cout << '\n';
+    }
+
+    return 0;
+}
@@ -0,0 +1,105 @@
+/* Copyright (c) 2024 Jrgen Grahn
+ * All rights reserved.
+ *
+ * Micro-benchmark: finding a program by name in a large schedule, the
+ * old way (a linear scan) and the current way (the Schedule's hash
+ * index). Commands like list and start_all do one lookup per
+ * program, so the linear scan made them quadratic.
+ */
+#include "schedule.h"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <cstdio>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    double ns_per(Clock::duration d, unsigned long n)
+    {
+	return std::chrono::duration<double, std::nano>(d).count() / n;
+    }
+
+    std::string name(unsigned i)
+    {
+	return "program" + std::to_string(i);
+    }
+
+    /* A config file with n programs, in a temporary file which is
+     * removed once the Schedule has read it.
+     */
+    bool schedule(unsigned n, std::vector<Schedule>& v)
+    {
+	char path[] = "/tmp/djcl-bench.XXXXXX";
+	const int fd = mkstemp(path);
+	if (fd==-1) return false;
+	close(fd);
+
+	{
+	    std::ofstream f {path};
+	    for (unsigned i = 0; i < n; i++) {
+		f << name(i) << ".exec = /bin/true " << i << '\n'
+		  << name(i) << ".cwd = /tmp\n";
+	    }
+	}
+
+	v.emplace_back(std::cerr, path);
+	unlink(path);
+	return v.back().valid();
+    }
+
+    const Command* linear(const Schedule& schedule, const Name& name)
+    {
+	for (auto& cmd : schedule) {
+	    if (cmd.name==name) return &cmd;
+	}
+	return nullptr;
+    }
+
+    template <class F>
+    double lookup(const std::vector<Name>& names, F f, unsigned long& found)
+    {
+	auto t0 = Clock::now();
+	for (const Name& name : names) {
+	    if (f(name)) found++;
+	}
+	return ns_per(Clock::now() - t0, names.size());
+    }
+}
+
+int main()
+{
+    std::printf("%8s %14s %14s %14s %14s\n",
+		"programs", "scan ns", "index ns", "scan list ms", "index list ms");
+
+    for (unsigned n : {100, 1000, 10000, 50000}) {
+	std::vector<Schedule> v;
+	if (!schedule(n, v)) return 1;
+	const Schedule& s = v.back();
+
+	std::mt19937 rng {4711};
+	std::uniform_int_distribution<unsigned> dist {0, n - 1};
+	std::vector<Name> names(std::min(n, 2000u));
+	for (Name& name : names) name = ::name(dist(rng));
+
+	unsigned long found = 0;
+	const double b = lookup(names, [&] (auto& name) { return linear(s, name); }, found);
+	const double a = lookup(names, [&] (auto& name) { return find(s, name); }, found);
+	if (found != 2 * names.size()) return 1;
+
+	/* A list or start_all does n lookups.
+	 */
+	std::printf("%8u %14.1f %14.1f %14.2f %14.2f\n",
+		    n, b, a, b * n / 1e6, a * n / 1e6);
+    }
+
+    return 0;
+}
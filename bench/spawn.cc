@@ -0,0 +1,122 @@
+/* Copyright (c) 2024 Jrgen Grahn
+ * All rights reserved.
+ *
+ * Benchmark: starting /bin/true with fork(2)+exec, the old way, and
+ * with spawn(), with our RSS at various sizes, and with various
+ * numbers of open fds (which the child's fd table is copied from).
+ * Latency is the time until the call returns to the parent; the rate
+ * includes reaping.
+ */
+#include "spawn.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    double us(Clock::duration d)
+    {
+	return std::chrono::duration<double, std::micro>(d).count();
+    }
+
+    Pid fork_exec(const Command& cmd, Pipe& stdout, Pipe& stderr, int& pidfd)
+    {
+	pidfd = -1;
+	const pid_t pid = fork();
+	if (pid) {
+	    stdout.parent();
+	    stderr.parent();
+	    return pid;
+	}
+
+	stdout.child(1);
+	stderr.child(2);
+	execve(cmd.image.path[0].c_str(), cmd.image.argv.data(), environ);
+	_exit(1);
+    }
+
+    Pid vfork_exec(const Command& cmd, Pipe& stdout, Pipe& stderr, int& pidfd)
+    {
+	bool execd;
+	return spawn(cmd, {}, nullptr, {}, -1, stdout, stderr, pidfd, execd);
+    }
+
+    struct Result {
+	double latency = 0;
+	double rate = 0;
+    };
+
+    template <class Spawn>
+    Result run(Spawn spawn, const Command& cmd, unsigned n)
+    {
+	Clock::duration t {};
+	const auto t0 = Clock::now();
+	for (unsigned i = 0; i < n; i++) {
+	    Pipe stdout;
+	    Pipe stderr;
+	    int pidfd;
+	    const auto t1 = Clock::now();
+	    const Pid pid = spawn(cmd, stdout, stderr, pidfd);
+	    t += Clock::now() - t1;
+	    if (!pid) return {};
+	    waitpid(pid.val, nullptr, 0);
+	    if (pidfd != -1) close(pidfd);
+	}
+	return {us(t) / n, n / us(Clock::now() - t0) * 1e6};
+    }
+}
+
+int main()
+{
+    Command cmd {"true"};
+    cmd.argv = {"/bin/true"};
+    cmd.prepare(environ);
+
+    std::printf("%8s %14s %14s %14s %14s\n",
+		"RSS MB", "fork us", "spawn us", "fork/s", "spawn/s");
+
+    std::vector<char> ballast;
+    for (unsigned mb : {0, 64, 256, 1024}) {
+	ballast.resize(mb << 20);
+	std::memset(ballast.data(), 1, ballast.size());
+
+	const unsigned n = 500;
+	const Result a = run(fork_exec, cmd, n);
+	const Result b = run(vfork_exec, cmd, n);
+	std::printf("%8u %14.1f %14.1f %14.0f %14.0f\n",
+		    mb, a.latency, b.latency, a.rate, b.rate);
+    }
+    ballast = {};
+    ballast.shrink_to_fit();
+
+    rlimit rl;
+    getrlimit(RLIMIT_NOFILE, &rl);
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &rl);
+
+    std::printf("\n%8s %14s %14s %14s %14s\n",
+		"fds", "fork us", "spawn us", "fork/s", "spawn/s");
+
+    std::vector<int> fds;
+    for (unsigned nfd : {0, 1000, 10000}) {
+	if (nfd + 100 > rl.rlim_cur) break;
+	while (fds.size() < nfd) fds.push_back(dup(0));
+
+	const unsigned n = 500;
+	const Result a = run(fork_exec, cmd, n);
+	const Result b = run(vfork_exec, cmd, n);
+	std::printf("%8u %14.1f %14.1f %14.0f %14.0f\n",
+		    nfd, a.latency, b.latency, a.rate, b.rate);
+    }
+
+    for (int fd : fds) close(fd);
+    return 0;
+}
@@ -0,0 +1,51 @@
+/* Copyright (c) 2024 Jrgen Grahn
+ * All rights reserved.
+ *
+ */
+#ifndef DJCL_CALLBACK_H
+#define DJCL_CALLBACK_H
+
+#include <new>
+#include <type_traits>
+#include <utility>
+
+template <class Sig> class Callback;
+
+/**
+ * Like std::function, but only for small, trivially copyable
+ * callables -- in practice lambdas capturing a pointer or two by
+ * reference. These are stored inline, so constructing, copying and
+ * calling never touches the heap. Trying to store something bigger
+ * is a compile-time error.
+ */
+template <class R, class... Args>
+class Callback<R(Args...)> {
+public:
+    Callback() = default;
+
+    template <class F,
+	      class = std::enable_if_t<!std::is_same_v<std::decay_t<F>, Callback>>>
+    Callback(F f)
+	: call {&invoke<F>}
+    {
+	static_assert(sizeof(F) <= sizeof buf, "callable too large for a Callback");
+	static_assert(alignof(F) <= alignof(void*), "callable too aligned for a Callback");
+	static_assert(std::is_trivially_copyable_v<F>, "callable not trivially copyable");
+	new (buf) F(f);
+    }
+
+    R operator() (Args... args) const { return call(buf, std::forward<Args>(args)...); }
+    explicit operator bool () const { return call; }
+
+private:
+    alignas(void*) mutable unsigned char buf[2 * sizeof(void*)] {};
+    R (*call)(void*, Args...) = nullptr;
+
+    template <class F>
+    static R invoke(void* p, Args... args)
+    {
+	return (*std::launder(static_cast<F*>(p)))(std::forward<Args>(args)...);
+    }
+};
+
+#endif
@@ -0,0 +1,134 @@
+/* Copyright (c) 2024 Jrgen Grahn
+ * All rights reserved.
+ *
+ */
+#include "cgroup.h"
+
+#include <set>
+#include <fstream>
+#include <cstring>
+
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include <linux/magic.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+namespace {
+
+    bool write(const std::string& path, const std::string& val)
+    {
+	const int fd = ::open(path.c_str(), O_WRONLY | O_CLOEXEC);
+	if (fd==-1) return false;
+	const ssize_t n = ::write(fd, val.data(), val.size());
+	const int err = errno;
+	::close(fd);
+	errno = err;
+	return n==ssize_t(val.size());
+    }
+
+    std::string controller(const std::string& key)
+    {
+	return key.substr(0, key.find('.'));
+    }
+
+    std::string strerror()
+    {
+	return std::strerror(errno);
+    }
+}
+
+Cgroups::Cgroups(const std::string& root)
+    : root {root}
+{}
+
+/**
+ * True if there's no root, or it's a cgroup v2 directory.
+ */
+bool Cgroups::valid() const
+{
+    if (empty()) return true;
+    struct statfs st;
+    return statfs(root.c_str(), &st)==0 && st.f_type==CGROUP2_SUPER_MAGIC;
+}
+
+/**
+ * Enable, for the programs' cgroups, the controllers their settings
+ * need. That fails if the root has processes of its own.
+ */
+bool Cgroups::enable(std::string& error, const Schedule& schedule) const
+{
+    std::set<std::string> cc;
+    for (const Command& cmd : schedule) {
+	for (const auto& setting : cmd.cgroup) {
+	    cc.insert(controller(setting.first));
+	}
+    }
+    if (cc.empty()) return true;
+
+    std::string s;
+    for (const auto& c : cc) {
+	if (s.size()) s += ' ';
+	s += '+' + c;
+    }
+
+    const std::string path = root + "/cgroup.subtree_control";
+    if (!write(path, s)) {
+	error = "cannot write '" + s + "' to " + path + ": " + strerror();
+	return false;
+    }
+    return true;
+}
+
+/**
+ * Create (unless it exists) and configure the cgroup for 'cmd', and
+ * return an fd to its cgroup.procs. Returns -1 and sets 'error' on
+ * failure, and also if the program simply has no cgroup.
+ */
+int Cgroups::open(std::string& error, const Command& cmd) const
+{
+    if (empty() || cmd.cgroup.empty()) return -1;
+
+    const std::string dir = root + '/' + cmd.name;
+    if (mkdir(dir.c_str(), 0755) && errno != EEXIST) {
+	error = "cannot create " + dir + ": " + strerror();
+	return -1;
+    }
+
+    for (const auto& setting : cmd.cgroup) {
+	if (!write(dir + '/' + setting.first, setting.second)) {
+	    error = "cannot set " + setting.first + " = " + setting.second
+		+ ": " + strerror();
+	    return -1;
+	}
+    }
+
+    const std::string path = dir + "/cgroup.procs";
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CLOEXEC);
+    if (fd==-1) {
+	error = "cannot open " + path + ": " + strerror();
+    }
+    return fd;
+}
+
+/**
+ * The value of 'key' in a flat-keyed file, like cpu.stat, in the
+ * cgroup for 'cmd'; or the first line if there's no key. Empty if
+ * there's no such cgroup, file or key.
+ */
+std::string Cgroups::read(const Command& cmd, const std::string& file,
+			  const std::string& key) const
+{
+    if (empty() || cmd.cgroup.empty()) return {};
+
+    std::ifstream f {root + '/' + cmd.name + '/' + file};
+    std::string s;
+    while (std::getline(f, s)) {
+	if (key.empty()) return s;
+	if (s.compare(0, key.size(), key)==0 && s[key.size()]==' ') {
+	    return s.substr(key.size() + 1);
+	}
+    }
+    return {};
+}
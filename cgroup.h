@@ -0,0 +1,35 @@
+/* Copyright (c) 2024 Jrgen Grahn
+ * All rights reserved.
+ *
+ */
+#ifndef DJCL_CGROUP_H
+#define DJCL_CGROUP_H
+
+#include "schedule.h"
+
+#include <string>
+
+/**
+ * A cgroup v2 directory, delegated to us, under which each program
+ * with cgroup settings (see Command) gets a cgroup of its own, named
+ * after the program. Without a root directory, there are no cgroups.
+ *
+ * The child puts itself into its cgroup before exec, using an fd
+ * from open(), so the program never runs outside it.
+ */
+class Cgroups {
+public:
+    explicit Cgroups(const std::string& root);
+    bool valid() const;
+    bool empty() const { return root.empty(); }
+
+    bool enable(std::string& error, const Schedule& schedule) const;
+    int open(std::string& error, const Command& cmd) const;
+    std::string read(const Command& cmd, const std::string& file,
+		     const std::string& key = "") const;
+
+private:
+    const std::string root;
+};
+
+#endif
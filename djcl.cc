@@ -7,13 +7,13 @@
 #include <vector>
 #include <algorithm>
 #include <cassert>
+#include <cstdlib>
 
 #include <getopt.h>
 #include <string.h>
 
 #include <sys/types.h>
 #include <sys/socket.h>
-#include <netdb.h>
 #include <errno.h>
 #include <signal.h>
 #include <unistd.h>
@@ -25,22 +25,15 @@
 
 #include "schedule.h"
 #include "parent.h"
-#include "sigpipe.h"
+#include "cgroup.h"
 #include "spider.h"
 #include "server.h"
 #include "log.h"
+#include "listen.h"
 
 
 namespace {
 
-    bool reuse_addr(int fd)
-    {
-	int val = 1;
-	return setsockopt(fd,
-			  SOL_SOCKET, SO_REUSEADDR,
-			  &val, sizeof val) == 0;
-    }
-
     bool setbuf(int fd, int rx)
     {
 	int err = setsockopt(fd, SOL_SOCKET, SO_RCVBUF,
@@ -48,6 +41,16 @@ namespace {
 	return !err;
     }
 
+    bool number(const char* s, unsigned& n)
+    {
+	char* end;
+	errno = 0;
+	const unsigned long val = std::strtoul(s, &end, 10);
+	if (end==s || *end || errno || val > ~0u) return false;
+	n = val;
+	return true;
+    }
+
     void ignore_sigpipe()
     {
 	static struct sigaction ignore;
@@ -55,76 +58,6 @@ namespace {
 	ignore.sa_flags = SA_RESTART;
 	(void)sigaction(SIGPIPE, &ignore, 0);
     }
-
-    /* Create a listening socket on host:port (the wildcard address if
-     * host is empty). Does everything including listen(), and prints
-     * relevant error messages.
-     */
-    int listening_socket(std::ostream& err,
-			 const std::string& host,
-			 const std::string& port)
-    {
-	struct addrinfo hints;
-	memset(&hints, 0, sizeof hints);
-	hints.ai_family = AF_UNSPEC;
-	hints.ai_socktype = SOCK_STREAM;
-	hints.ai_flags = AI_PASSIVE;
-	hints.ai_protocol = 0;
-	hints.ai_canonname = NULL;
-	hints.ai_addr = NULL;
-	hints.ai_next = NULL;
-
-	struct addrinfo *result;
-	const int s = getaddrinfo(host.empty()? 0: host.c_str(),
-				  port.c_str(),
-				  &hints, &result);
-	if(s) {
-	    err << "error: " << gai_strerror(s) << '\n';
-	    return -1;
-	}
-
-	int fd = -1;
-	const addrinfo* rp;
-	for(rp = result; rp; rp = rp->ai_next) {
-	    const addrinfo& r = *rp;
-
-	    fd = socket(r.ai_family,
-			r.ai_socktype | SOCK_CLOEXEC,
-			r.ai_protocol);
-	    if(fd == -1) continue;
-
-	    if(reuse_addr(fd)
-	       && bind(fd, r.ai_addr, r.ai_addrlen) == 0) {
-		break;
-	    }
-
-	    close(fd);
-	}
-
-	freeaddrinfo(result);
-
-	if(!rp || !setbuf(fd, 8192) || listen(fd, 10)==-1) {
-	    err << "socket error: " << strerror(errno) << '\n';
-	    return -1;
-	}
-
-	return fd;
-    }
-
-    namespace sigchld {
-
-	Sigpipe pipe;
-
-	void handler(int) { pipe.set(); }
-    }
-
-    void catch_sigchld()
-    {
-	struct sigaction sa = {};
-	sa.sa_handler = sigchld::handler;
-	sa.sa_flags = SA_NOCLDSTOP | SA_RESTART;
-	(void)sigaction(SIGCHLD, &sa, nullptr);
-    }
 }
 
 
@@ -134,12 +67,24 @@ int main(int argc, char ** argv)
     const std::string usage = "usage: "
 	+ prog +
 	" [-d]"
+	" [-e]"
+	" [-u]"
+	" [-j max-starting]"
+	" [-r start-rate]"
+	" [-c cgroup]"
+	" [-s interval]"
 	" [-a listen-address]"
 	" -p port"
 	" -f config";
-    const char optstring[] = "dp:a:f:";
+    const char optstring[] = "deuj:r:c:s:p:a:f:";
     const struct option long_options[] = {
 	{"daemon",       0, 0, 'd'},
+	{"edge-triggered", 0, 0, 'e'},
+	{"io-uring",     0, 0, 'u'},
+	{"max-starting", 1, 0, 'j'},
+	{"start-rate",   1, 0, 'r'},
+	{"cgroup",       1, 0, 'c'},
+	{"sample",       1, 0, 's'},
 	{"address",      1, 0, 'a'},
 	{"port",         1, 0, 'p'},
 	{"version", 	 0, 0, 'v'},
@@ -148,6 +93,11 @@ int main(int argc, char ** argv)
     };
 
     bool daemonize = false;
+    bool edge = false;
+    bool uring = false;
+    Parent::Pace pace;
+    std::string cgroot;
+    unsigned sample = 0;
     std::string addr;
     std::string port;
     std::string config;
@@ -159,6 +109,33 @@ int main(int argc, char ** argv)
 	case 'd':
 	    daemonize = true;
 	    break;
+	case 'e':
+	    edge = true;
+	    break;
+	case 'u':
+	    uring = true;
+	    break;
+	case 'j':
+	    if (!number(optarg, pace.starting)) {
+		std::cerr << "error: bad --max-starting '" << optarg << "'\n";
+		return 1;
+	    }
+	    break;
+	case 'r':
+	    if (!number(optarg, pace.rate)) {
+		std::cerr << "error: bad --start-rate '" << optarg << "'\n";
+		return 1;
+	    }
+	    break;
+	case 'c':
+	    cgroot = optarg;
+	    break;
+	case 's':
+	    if (!number(optarg, sample)) {
+		std::cerr << "error: bad --sample '" << optarg << "'\n";
+		return 1;
+	    }
+	    break;
 	case 'a':
 	    addr = optarg;
 	    break;
@@ -196,18 +173,50 @@ int main(int argc, char ** argv)
     const Schedule schedule {std::cerr, config};
     if (!schedule.valid()) return 1;
 
-    const int lfd = listening_socket(std::cerr, addr, port);
+    if (!sample && std::any_of(schedule.begin(), schedule.end(),
+			       [] (auto& cmd) { return cmd.watchdog.size(); })) {
+	std::cerr << "error: the config has watchdog rules, which need sampling (-s)\n";
+	return 1;
+    }
+
+    const Cgroups cgroups {cgroot};
+    if (!cgroups.valid()) {
+	std::cerr << "error: " << cgroot << " is not a cgroup v2 directory\n";
+	return 1;
+    }
+    if (cgroups.empty() && std::any_of(schedule.begin(), schedule.end(),
+				       [] (auto& cmd) { return cmd.cgroup.size(); })) {
+	std::cerr << "error: the config has cgroup settings, but no -c\n";
+	return 1;
+    }
+    std::string error;
+    if (!cgroups.enable(error, schedule)) {
+	std::cerr << "error: " << error << '\n';
+	return 1;
+    }
+
+    const Sockets sockets {std::cerr, schedule};
+    if (!sockets.valid()) return 1;
+
+    const int lfd = listening_socket(std::cerr, addr, port, 10, SOCK_NONBLOCK);
     if (lfd==-1) return 1;
+    if (!setbuf(lfd, 8192)) {
+	std::cerr << "socket error: " << strerror(errno) << '\n';
+	return 1;
+    }
 
     Syslog& log = Syslog::log;
 
     if (addr.empty()) addr = "*";
     Info(log) << "listening on " << addr << ':' << port;
+    for (const Command& cmd : schedule) {
+	for (const Endpoint& ep : cmd.listen) {
+	    Info(log) << cmd.name << ": listening on " << ep;
+	}
+    }
 
     ignore_sigpipe();
 
-    catch_sigchld();
-
     if(daemonize) {
 	int err = daemon(0, 0);
 	if(err) {
@@ -218,16 +227,15 @@ int main(int argc, char ** argv)
 	log.activate();
     }
 
-    Spider spider;
+    Spider spider {edge, uring};
+    if (uring && spider.backend() != std::string{"io_uring"}) {
+	Warning(log) << "io_uring not available; using epoll";
+    }
 
-    auto outf = [&] (auto fd, auto f) { spider.read(fd, f); };
-    Parent parent {schedule, log, outf};
+    log.hold(true);
+    spider.idle([&] { log.commit(); });
 
-    spider.read(sigchld::pipe.readfd(),
-		[&] (int) {
-		    sigchld::pipe.drain();
-		    parent.wait();
-		});
+    Parent parent {schedule, log, spider, pace, cgroups, sockets, sample};
 
     Server server {log, spider, parent};
 
@@ -236,6 +244,11 @@ int main(int argc, char ** argv)
 		    server.connect(lfd);
 		});
 
-    spider.loop();
+    try {
+	spider.loop();
+    }
+    catch (const FatalError&) {
+	return 1;
+    }
     return 0;
 }
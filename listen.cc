@@ -0,0 +1,163 @@
+/* Copyright (c) 2013, 2024 Jrgen Grahn
+ * All rights reserved.
+ *
+ */
+#include "listen.h"
+
+#include "schedule.h"
+
+#include <iostream>
+#include <cstring>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#include <errno.h>
+#include <unistd.h>
+
+namespace {
+
+    bool reuse_addr(int fd)
+    {
+	int val = 1;
+	return setsockopt(fd,
+			  SOL_SOCKET, SO_REUSEADDR,
+			  &val, sizeof val) == 0;
+    }
+}
+
+/**
+ * Parse "tcp:host:port", "tcp:[host]:port" (for IPv6 addresses) or
+ * "tcp:port". A host of "*" is the wildcard address, like no host.
+ */
+bool endpoint(Endpoint& ep, const std::string& s)
+{
+    if (s.compare(0, 4, "tcp:")) return false;
+    std::string host;
+    std::string port = s.substr(4);
+
+    if (port.size() && port[0]=='[') {
+	const auto n = port.find("]:");
+	if (n==std::string::npos) return false;
+	host = port.substr(1, n - 1);
+	port = port.substr(n + 2);
+	if (host.empty()) return false;
+    }
+    else {
+	const auto n = port.find(':');
+	if (n != std::string::npos) {
+	    host = port.substr(0, n);
+	    port = port.substr(n + 1);
+	    if (host.empty()) return false;
+	}
+    }
+
+    if (port.empty() || port.find(':') != std::string::npos) return false;
+    if (host=="*") host.clear();
+    ep = {host, port};
+    return true;
+}
+
+std::ostream& operator<< (std::ostream& os, const Endpoint& ep)
+{
+    os << "tcp:";
+    if (ep.host.empty()) os << '*';
+    else if (ep.host.find(':') != std::string::npos) os << '[' << ep.host << ']';
+    else os << ep.host;
+    return os << ':' << ep.port;
+}
+
+/**
+ * Create a listening socket on host:port (the wildcard address if
+ * host is empty), close-on-exec and with 'flags' like SOCK_NONBLOCK.
+ * Does everything including listen(), and prints relevant error
+ * messages.
+ */
+int listening_socket(std::ostream& err,
+		     const std::string& host,
+		     const std::string& port,
+		     int backlog, int flags)
+{
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof hints);
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    hints.ai_protocol = 0;
+    hints.ai_canonname = NULL;
+    hints.ai_addr = NULL;
+    hints.ai_next = NULL;
+
+    struct addrinfo *result;
+    const int s = getaddrinfo(host.empty()? 0: host.c_str(),
+			      port.c_str(),
+			      &hints, &result);
+    if(s) {
+	err << "error: " << gai_strerror(s) << '\n';
+	return -1;
+    }
+
+    int fd = -1;
+    const addrinfo* rp;
+    for(rp = result; rp; rp = rp->ai_next) {
+	const addrinfo& r = *rp;
+
+	fd = socket(r.ai_family,
+		    r.ai_socktype | SOCK_CLOEXEC | flags,
+		    r.ai_protocol);
+	if(fd == -1) continue;
+
+	if(reuse_addr(fd)
+	   && bind(fd, r.ai_addr, r.ai_addrlen) == 0) {
+	    break;
+	}
+
+	close(fd);
+    }
+
+    freeaddrinfo(result);
+
+    if(!rp || listen(fd, backlog)==-1) {
+	err << "socket error: " << strerror(errno) << '\n';
+	if(rp) close(fd);
+	return -1;
+    }
+
+    return fd;
+}
+
+/**
+ * Bind everything, or write to 'err' and be not valid().
+ */
+Sockets::Sockets(std::ostream& err, const Schedule& schedule)
+{
+    for (const Command& cmd : schedule) {
+	for (const Endpoint& ep : cmd.listen) {
+	    const int fd = listening_socket(err, ep.host, ep.port, SOMAXCONN, 0);
+	    if (fd==-1) {
+		err << "error: " << cmd.name << " cannot listen on " << ep << '\n';
+		fail = true;
+		continue;
+	    }
+	    v[cmd.name].push_back(fd);
+	}
+    }
+}
+
+Sockets::~Sockets()
+{
+    for (auto& [name, fds] : v) {
+	for (int fd : fds) close(fd);
+    }
+}
+
+/**
+ * The sockets for program 'name', in configuration order.
+ */
+const std::vector<int>& Sockets::fds(const std::string& name) const
+{
+    static const std::vector<int> none;
+    auto it = v.find(name);
+    if (it==v.end()) return none;
+    return it->second;
+}
@@ -0,0 +1,54 @@
+/* Copyright (c) 2024 Jrgen Grahn
+ * All rights reserved.
+ *
+ */
+#ifndef DJCL_LISTEN_H
+#define DJCL_LISTEN_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <iosfwd>
+
+class Schedule;
+
+/**
+ * A TCP address to listen on, like "tcp:0.0.0.0:8080", "tcp:[::1]:80"
+ * or "tcp:8080". An empty host means the wildcard address.
+ */
+struct Endpoint {
+    std::string host;
+    std::string port;
+};
+
+bool endpoint(Endpoint& ep, const std::string& s);
+std::ostream& operator<< (std::ostream& os, const Endpoint& ep);
+
+int listening_socket(std::ostream& err,
+		     const std::string& host,
+		     const std::string& port,
+		     int backlog, int flags);
+
+/**
+ * The listening sockets of all programs in a Schedule, bound once
+ * and kept open for as long as we run, so that connections queue up
+ * in the backlog while a program restarts. Each program gets its own
+ * as fds 3 and up, with $LISTEN_FDS and $LISTEN_PID as in
+ * sd_listen_fds(3).
+ */
+class Sockets {
+public:
+    Sockets(std::ostream& err, const Schedule& schedule);
+    ~Sockets();
+    Sockets(const Sockets&) = delete;
+    Sockets& operator= (const Sockets&) = delete;
+
+    bool valid() const { return !fail; }
+    const std::vector<int>& fds(const std::string& name) const;
+
+private:
+    std::unordered_map<std::string, std::vector<int>> v;
+    bool fail = false;
+};
+
+#endif
@@ -14,6 +14,8 @@
 
 #include <sys/uio.h>
 #include <sys/time.h>
+#include <unistd.h>
+#include <errno.h>
 
 namespace {
 
@@ -39,6 +41,7 @@ Syslog::Syslog()
 
 Syslog::~Syslog()
 {
+    commit();
     closelog();
 }
 
@@ -48,6 +51,13 @@ void Syslog::flush(int prio)
 	*pptr() = '\0';
 	syslog(prio, "%s", pbase());
     }
+    else if (holding) {
+	auto header = timestamp();
+	held.append(header.data(), header.size());
+	held.append(pbase(), pptr());
+	held.push_back('\n');
+	if (held.size() > 64 * 1024) commit();
+    }
     else {
 	char nl = '\n';
 	auto header = timestamp();
@@ -64,5 +74,34 @@ void Syslog::flush(int prio)
 
 void Syslog::activate()
 {
+    commit();
     use_syslog = true;
 }
+
+/**
+ * Hold back messages until commit(), or not.
+ */
+void Syslog::hold(bool val)
+{
+    if (!val) commit();
+    holding = val;
+}
+
+/**
+ * Write any messages held back.
+ */
+void Syslog::commit()
+{
+    const char* p = held.data();
+    size_t n = held.size();
+    while (n) {
+	const ssize_t rc = write(1, p, n);
+	if (rc==-1) {
+	    if (errno==EINTR) continue;
+	    break;
+	}
+	p += rc;
+	n -= rc;
+    }
+    held.clear();
+}
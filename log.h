@@ -10,6 +10,7 @@
 #include <iostream>
 #include <streambuf>
 #include <array>
+#include <string>
 
 #include <syslog.h>
 
@@ -29,6 +30,10 @@
  * Class Syslog implements the ostream, a fixed, limited-size stream buffer,
  * and the syslogging.  The Log<Prio> template makes the syntax acceptable.
  * Overlong messages will simply be truncated.
+ *
+ * When writing to stdout, messages can be held back and written in
+ * batches by commit(), so that a burst of them costs one write(2)
+ * rather than one each.
  */
 class Syslog : private std::basic_streambuf<char> {
 public:
@@ -38,6 +43,8 @@ public:
     void flush(int prio);
 
     void activate();
+    void hold(bool val);
+    void commit();
 
     /**
      * Since the syslog is naturally process-global and reentrancy is
@@ -45,10 +52,17 @@ public:
      */
     static Syslog log;
 
+    /**
+     * The longest message which isn't truncated.
+     */
+    static constexpr size_t capacity = 499;
+
 private:
-    std::array<char_type, 500> v;
+    std::array<char_type, capacity + 1> v;
     std::ostream os;
     bool use_syslog = false;
+    bool holding = false;
+    std::string held;
 };
 
 /**
@@ -0,0 +1,108 @@
+/* Copyright (c) 2024 Jrgen Grahn
+ * All rights reserved.
+ *
+ */
+#include "notify.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cstddef>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+NotifySocket::NotifySocket()
+    : fd {socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0)}
+{
+    if (fd==-1) return;
+
+    /* Binding just the family autobinds, see unix(7): the kernel
+     * picks a unique abstract address.
+     */
+    sockaddr_un sa = {};
+    sa.sun_family = AF_UNIX;
+    auto addr = reinterpret_cast<sockaddr*>(&sa);
+    const int one = 1;
+    bool ok = setsockopt(fd, SOL_SOCKET, SO_PASSCRED, &one, sizeof one)==0;
+    ok = ok && bind(fd, addr, sizeof sa.sun_family)==0;
+    socklen_t len = sizeof sa;
+    ok = ok && getsockname(fd, addr, &len)==0;
+    if (!ok) {
+	close(fd);
+	fd = -1;
+	return;
+    }
+
+    const size_t n = len - offsetof(sockaddr_un, sun_path);
+    address = '@' + std::string {sa.sun_path + 1, n - 1};
+}
+
+NotifySocket::~NotifySocket()
+{
+    if (fd != -1) close(fd);
+}
+
+/**
+ * Like recv(2), but also yields the sender's pid, or 0 if that's
+ * unknown.
+ */
+ssize_t NotifySocket::recv(char* buf, size_t size, pid_t& sender) const
+{
+    iovec iov {buf, size};
+    union {
+	cmsghdr align;
+	char buf[CMSG_SPACE(sizeof(ucred))];
+    } control;
+    msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof control.buf;
+
+    const ssize_t n = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+    sender = 0;
+    for (cmsghdr* c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+	if (c->cmsg_level==SOL_SOCKET && c->cmsg_type==SCM_CREDENTIALS) {
+	    ucred cred;
+	    std::memcpy(&cred, CMSG_DATA(c), sizeof cred);
+	    sender = cred.pid;
+	}
+    }
+    return n;
+}
+
+/**
+ * Like recv(), but silently dropping datagrams which aren't from
+ * process 'pid', including those from unknown senders. Anyone on the
+ * host can send to the socket.
+ */
+ssize_t NotifySocket::recv_from(char* buf, size_t size, pid_t pid) const
+{
+    ssize_t n;
+    pid_t sender;
+    while ((n = recv(buf, size, sender)) != -1) {
+	if (pid && sender==pid) break;
+    }
+    return n;
+}
+
+/**
+ * Parse a datagram like "READY=1\nSTATUS=Processing requests\n".
+ */
+Notification parse(const char* a, const char* b)
+{
+    Notification n;
+    while (a!=b) {
+	const char* eol = std::find(a, b, '\n');
+	const std::string s {a, eol};
+	if (s=="READY=1") n.ready = true;
+	else if (s=="WATCHDOG=1") n.watchdog = true;
+	else if (s.compare(0, 7, "STATUS=")==0) {
+	    n.has_status = true;
+	    n.status = s.substr(7);
+	}
+	a = eol==b ? b : eol + 1;
+    }
+    return n;
+}
@@ -0,0 +1,45 @@
+/* Copyright (c) 2024 Jrgen Grahn
+ * All rights reserved.
+ *
+ */
+#ifndef DJCL_NOTIFY_H
+#define DJCL_NOTIFY_H
+
+#include <string>
+
+#include <sys/types.h>
+
+/**
+ * A datagram socket for sd_notify(3)-style messages from a program:
+ * READY=1, STATUS=text and WATCHDOG=1, one per line, several per
+ * datagram. It's bound to an abstract address the kernel picks, which
+ * the program finds in $NOTIFY_SOCKET. The kernel also tells us which
+ * process sent each one.
+ */
+class NotifySocket {
+public:
+    NotifySocket();
+    ~NotifySocket();
+    NotifySocket(const NotifySocket&) = delete;
+    NotifySocket& operator= (const NotifySocket&) = delete;
+
+    bool valid() const { return fd != -1; }
+    ssize_t recv(char* buf, size_t size, pid_t& sender) const;
+    ssize_t recv_from(char* buf, size_t size, pid_t pid) const;
+    int fd;
+    std::string address;
+};
+
+/**
+ * What a datagram said. Unknown lines are ignored.
+ */
+struct Notification {
+    bool ready = false;
+    bool watchdog = false;
+    bool has_status = false;
+    std::string status;
+};
+
+Notification parse(const char* a, const char* b);
+
+#endif
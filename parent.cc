@@ -1,93 +1,120 @@
 #include "parent.h"
 
-#include "split.h"
+#include "spawn.h"
 
 #include <sys/wait.h>
+#include <sys/syscall.h>
+#include <sys/socket.h>
+#include <sys/prctl.h>
+#include <sys/signalfd.h>
 #include <unistd.h>
 #include <stdlib.h>
 #include <signal.h>
 
+#include <algorithm>
 #include <cstring>
 #include <cstdio>
 #include <iostream>
+#include <sstream>
 
 namespace {
 
-    char* next(char*& p)
+    using namespace std::chrono_literals;
+
+    /* Restarting: a process which exits within 'quick' of starting
+     * counts as crashing, and is restarted after a backoff which
+     * doubles for each crash in a row, from 'first' up to 'longest',
+     * and then jittered down by up to half. After 'limit' crashes in
+     * a row we give up.
+     */
+    constexpr auto quick = 10s;
+    constexpr auto first = 1s;
+    constexpr auto longest = 60s;
+    constexpr unsigned limit = 10;
+
+    /* Thin wrapper; <sys/pidfd.h> in some glibc versions lacks
+     * extern "C", so it's unusable from C++.
+     */
+    int pidfd_kill(int pidfd, int sig)
     {
-	while(*p) p++;
-	p++;
-	return p;
+	return syscall(SYS_pidfd_send_signal, pidfd, sig, nullptr, 0);
     }
 
-    constexpr char nil = '\0';
-
-    /**
-     * Constructing the argv for execvp(2).
+    /* Signal the process group led by 'pid', i.e. a program and what
+     * it has started (unless that has moved to a group of its own).
+     * Like with a pidfd, there's no race with the pid being reused,
+     * as long as the leader hasn't been reaped.
      */
-    class Argv {
-    public:
-	explicit Argv(const std::vector<std::string>& ss);
-	Argv(const Argv&) = delete;
-	Argv& operator= (const Argv&) = delete;
+    int kill_group(const Pid& pid, int sig)
+    {
+	return ::killpg(pid.val, sig);
+    }
 
-	std::vector<char*> val;
+    /* The waitid system call, which unlike the libc function also
+     * returns the resource usage.
+     */
+    int waitid(int pidfd, siginfo_t& info, rusage& ru)
+    {
+	return syscall(SYS_waitid, P_PIDFD, pidfd, &info, WEXITED | WNOHANG, &ru);
+    }
 
-    private:
-	std::string buf;
-    };
+    std::chrono::microseconds us(const timeval& tv)
+    {
+	return std::chrono::seconds {tv.tv_sec} + std::chrono::microseconds {tv.tv_usec};
+    }
 
-    Argv::Argv(const std::vector<std::string>& ss)
-	: val {ss.size() + 1, nullptr},
-	  buf {join(nil, ss)}
+    /* Where to run 'cmd': as configured, but with "auto" resolved
+     * to the n:th spread-out placement, and with a NUMA node but no
+     * CPUs meaning the node's CPUs.
+     */
+    Placement placement(const Topology& topology, const Command& cmd, unsigned n)
     {
-	char* p = &buf.front();
-	for (unsigned i = 0; i < ss.size(); i++) {
-	    val[i] = p;
-	    next(p);
+	Placement where = cmd.place;
+	if (cmd.auto_cpus || cmd.auto_node) {
+	    const Placement spread = topology.spread(n, cmd.auto_cpus, cmd.auto_node);
+	    if (cmd.auto_node) where.node = spread.node;
+	    if (cmd.auto_cpus || where.cpus.empty()) where.cpus = spread.cpus;
+	}
+	if (where.node != -1 && where.cpus.empty()) {
+	    where.cpus = topology.cpus(where.node);
 	}
+	return where;
     }
 
-    Pid spawn(Syslog& log, Command cmd, Pipe& stdout, Pipe& stderr)
+    Pid spawn(Syslog& log, const Cgroups& cgroups,
+	      const Command& cmd, const Name& name, const Placement& where,
+	      char* const* envp, const std::vector<int>& listen,
+	      Pipe& stdout, Pipe& stderr, int& pidfd, bool& execd)
     {
-	const auto pid = fork();
-	if (pid==-1) {
-	    Err{log} << "cannot fork: " << std::strerror(errno);
-	    return pid;
+	int cgroup = -1;
+	if (cmd.cgroup.size()) {
+	    std::string error;
+	    cgroup = cgroups.open(error, cmd);
+	    if (cgroup==-1) {
+		Err{log} << "cannot start " << name << ": " << error;
+		return {};
+	    }
 	}
 
-	if (pid) {
-	    Info{log} << "started " << cmd.name << ' ' << Pid{pid};
-
-	    stdout.parent();
-	    stderr.parent();
+	const Pid pid = ::spawn(cmd, where, envp, listen, cgroup, stdout, stderr, pidfd, execd);
+	const int err = errno;
+	if (cgroup != -1) close(cgroup);
+	if (!pid) {
+	    Err{log} << "cannot start " << name << ": " << std::strerror(err);
 	    return pid;
 	}
 
-	/* In the child process. As usual after forking, it's a matter
-	 * of releasing resources that shouldn't be shared, setting up
-	 * stdin/stdout/stderr, setting environment and $CWD, and
-	 * lastly calling exec.
-	 */
-	stdout.child(1);
-	stderr.child(2);
-
-	for (auto& s : cmd.env) putenv(s.data());
-
-	if (cmd.cwd.size() && chdir(cmd.cwd.c_str())) {
-	    std::cerr << "error: " << cmd.name << ": cannot chdir to "
-		      << cmd.cwd << ": "
-		      << std::strerror(errno) << '\n';
-	    std::exit(1);
-	}
-
-	const Argv argv {cmd.argv};
-	execvp(argv.val[0], argv.val.data());
-
-	std::cerr << "error: " << cmd.name << ": exec failed: "
-		  << std::strerror(errno) << '\n';
+	Info{log} << "started " << name << ' ' << pid;
+	return pid;
+    }
 
-	std::exit(1);
+    /* "SIGTERM" and so on.
+     */
+    std::string signame(int sig)
+    {
+	const char* s = sigabbrev_np(sig);
+	if (!s) return "signal " + std::to_string(sig);
+	return std::string {"SIG"} + s;
     }
 
     /* Render the information as e.g.
@@ -117,12 +144,6 @@ namespace {
 	    return os;
 	}
     }
-
-    template <class Key, class Val>
-    void assign(std::map<Key, Val>& m, Key key, const Val& val)
-    {
-	m.insert_or_assign(key, val);
-    }
 }
 
 /**
@@ -131,87 +152,399 @@ namespace {
  */
 Parent::Parent(const Schedule& schedule,
 	       Syslog& log,
-	       std::function<void(int, std::function<void(int)>)> reg)
+	       Spider& spider,
+	       Pace pace,
+	       const Cgroups& cgroups,
+	       const Sockets& sockets,
+	       unsigned interval)
     : schedule {schedule},
       log {log},
-      reg {reg}
+      spider {spider},
+      cgroups {cgroups},
+      sockets {sockets},
+      pace {pace},
+      rng {std::random_device{}()},
+      interval {interval}
 {
+    /* Become the parent of whatever our programs leave behind when
+     * they exit, so it can be reaped, and told about SIGCHLD.
+     */
+    prctl(PR_SET_CHILD_SUBREAPER, 1);
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+    const int sigchld = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (sigchld != -1) {
+	spider.read(sigchld, [this] (int fd) { reaper(fd); });
+    }
+
+    const Topology topology;
+    unsigned n = 0;
+
+    auto instances = [&topology] (const Command& cmd) {
+	return cmd.auto_instances ? std::max(topology.size(), 1u) : cmd.instances;
+    };
+
+    size_t size = 0;
+    for (const Command& cmd : schedule) size += instances(cmd);
+    pp.reserve(size);
+
     for (const Command& cmd : schedule) {
-	start(cmd);
+	const bool spread = cmd.auto_cpus || cmd.auto_node;
+	for (unsigned i = 0; i < instances(cmd); i++) {
+	    const Name name = cmd.replicated() ? cmd.name + '@' + std::to_string(i) : cmd.name;
+	    Program& p = pp.emplace_back(cmd, name, placement(topology, cmd, spread ? n++ : 0));
+	    if (cmd.replicated()) {
+		p.env.push_back("DJCL_INSTANCE=" + std::to_string(i));
+		names[name].push_back(&p);
+	    }
+	    names[cmd.name].push_back(&p);
+	}
+    }
+
+    for (Program& p : pp) {
+	if (p.cmd.notify) notifier(p);
+	if (p.cmd.listen.size()) {
+	    p.env.push_back("LISTEN_FDS=" + std::to_string(p.cmd.listen.size()));
+	    p.env.push_back("LISTEN_PID=" + std::string(10, ' '));
+	}
+	environment(p);
+	for (const Name& name : p.cmd.after) {
+	    for (Program* dep : *programs(name)) {
+		p.deps.push_back(dep);
+		dep->dependents.push_back(&p);
+	    }
+	}
+    }
+
+    for (Program& p : pp) {
+	want(p);
+    }
+    pump();
+
+    if (interval) {
+	sampler = spider.after(std::chrono::seconds {interval}, [this] { sample(); });
     }
 }
 
-Parent::Stream::Stream(const Name& pname, const char* sname, std::unique_ptr<Pipe> pipe)
-    : pname {pname},
+Parent::Stream::Stream(Program& program, const char* sname, std::unique_ptr<Pipe> pipe)
+    : program {program},
       sname {sname},
       pipe {std::move(pipe)},
-      text {"\n"}
+      text {"\n", true}
 {}
 
 // void shutdown();
 
-namespace {
+/**
+ * The program 'name', or all instances of it, or null.
+ */
+const std::vector<Parent::Program*>* Parent::programs(const Name& name) const
+{
+    auto it = names.find(name);
+    if (it==end(names)) return nullptr;
+    return &it->second;
+}
 
-    template <class Map>
-    typename Map::key_type key_of(const Map& map,
-				  const typename Map::mapped_type& val)
-    {
-	for (auto& e : map) {
-	    if (e.second==val) return e.first;
+/**
+ * Start 'p' once the programs it's to start after are ready: queue it
+ * now, or leave it waiting. It's up to the caller to pump().
+ */
+void Parent::want(Program& p)
+{
+    p.waiting = !std::all_of(begin(p.deps), end(p.deps),
+			     [] (const Program* dep) { return dep->ready(); });
+    if (!p.waiting) enqueue(p);
+}
+
+void Parent::enqueue(Program& p)
+{
+    p.queued = true;
+    queue.push_back(&p);
+}
+
+/**
+ * Start queued programs, as far as the Pace allows. If it's the rate
+ * which stops us, a timer takes over. The starts are spread out
+ * evenly, except we catch up on at most 100 ms worth at a time, since
+ * the timer isn't that precise.
+ */
+void Parent::pump()
+{
+    using namespace std::chrono;
+    if (pumping) return;
+    pumping = true;
+
+    while (queue.size()) {
+	if (pace.starting && nstarting >= pace.starting) break;
+
+	const auto now = steady_clock::now();
+	if (pace.rate && now < next_start) {
+	    if (!pacer) {
+		auto d = ceil<milliseconds>(next_start - now);
+		pacer = spider.after(d, [this] { pacer = {}; pump(); });
+	    }
+	    break;
+	}
+
+	Program& p = *queue.front();
+	queue.pop_front();
+	p.queued = false;
+	start(p);
+
+	if (pace.rate) {
+	    next_start = std::max(next_start, now - 100ms);
+	    next_start += duration_cast<steady_clock::duration>(1s) / pace.rate;
+	}
+    }
+
+    pumping = false;
+}
+
+/**
+ * 'p' no longer counts as starting, so some other program might. If
+ * it's actually running, programs waiting for it might too.
+ */
+void Parent::ready(Program& p)
+{
+    if (!p.starting) return;
+    p.starting = false;
+    nstarting--;
+    if (p.deadline) spider.cancel(p.deadline);
+    if (p.ready()) {
+	if (p.old.pid) retire(p);
+	for (Program* other : p.dependents) {
+	    if (other->waiting) want(*other);
+	}
+    }
+    pump();
+}
+
+/**
+ * 'p' notifies, but hasn't said it's ready in time. Stop it, and let
+ * something else start meanwhile; whatever waits for it keeps
+ * waiting. If it was replacing something, that stays.
+ */
+void Parent::late(Program& p)
+{
+    p.deadline = {};
+    if (!p.starting) return;
+    Warning{log} << p.name << ' ' << p.pid << ": not ready after "
+		 << p.cmd.start_timeout << " s; stopping it";
+
+    p.starting = false;
+    nstarting--;
+    std::ostringstream os;
+    if (!signal(os, p)) Err{log} << os.str();
+    pump();
+}
+
+/**
+ * The environment for 'p', if we add anything: the one in the
+ * Command, with our variables replacing any by the same name.
+ */
+void Parent::environment(Program& p)
+{
+    if (p.env.empty()) return;
+
+    auto ours = [&p] (const char* e) {
+	const size_t n = std::strcspn(e, "=") + 1;
+	return std::any_of(begin(p.env), end(p.env),
+			   [=] (auto& s) { return s.compare(0, n, e, n)==0; });
+    };
+
+    const auto& image = p.cmd.image;
+    for (char* const* e = image.envp.size() ? image.envp.data() : environ; *e; e++) {
+	if (!ours(*e)) p.envp.push_back(*e);
+    }
+    for (auto& s : p.env) p.envp.push_back(s.data());
+    p.envp.push_back(nullptr);
+}
+
+/**
+ * Give 'p' a socket to notify us on, and variables which point it
+ * out (and say how often to send WATCHDOG=1, if we expect that).
+ */
+void Parent::notifier(Program& p)
+{
+    auto ns = std::make_unique<NotifySocket>();
+    if (!ns->valid()) {
+	Err{log} << p.name << ": cannot create notify socket: " << std::strerror(errno);
+	return;
+    }
+
+    p.env.push_back("NOTIFY_SOCKET=" + ns->address);
+    for (const auto& w : p.cmd.watchdog) {
+	if (w.metric != Command::Watchdog::Metric::notify) continue;
+	p.env.push_back("WATCHDOG_USEC=" + std::to_string(std::lround(w.limit * 1e6)));
+	break;
+    }
+
+    spider.read(ns->fd, [this, &p] (int) { notified(p); });
+    p.notify = std::move(ns);
+}
+
+/**
+ * There are notifications for 'p'. Only the ones from its own
+ * process count; not from its children, not from the process it's
+ * replacing, and not from anyone else who found the socket.
+ */
+void Parent::notified(Program& p)
+{
+    using namespace std::chrono;
+    char buf[4096];
+    ssize_t n;
+    while ((n = p.notify->recv_from(buf, sizeof buf, p.pid.val)) != -1) {
+	const Notification msg = parse(buf, buf + n);
+	const auto now = steady_clock::now();
+
+	if (msg.has_status) p.status = msg.status;
+	if (msg.watchdog) p.pinged = now;
+	if (msg.ready && p.starting) {
+	    p.pinged = now;
+	    p.ready_in = now - p.started;
+	    Info{log} << p.name << ' ' << p.pid << ": ready after "
+		      << duration<double>(p.ready_in).count() << " s";
+	    ready(p);
 	}
-	return {};
     }
 }
 
 /**
  * Helper.
  */
-Pid Parent::start(const Command& cmd)
+Pid Parent::start(Program& p)
 {
+    const Command& cmd = p.cmd;
     auto stdout = std::make_unique<Pipe>();
     auto stderr = std::make_unique<Pipe>();
-    const Pid pid = spawn(log, cmd, *stdout, *stderr);
+    int pidfd;
+    bool execd;
+    char* const* envp = p.envp.size() ? p.envp.data() : nullptr;
+    const Pid pid = spawn(log, cgroups, cmd, p.name, p.where,
+			  envp, sockets.fds(cmd.name),
+			  *stdout, *stderr, pidfd, execd);
 
     if (!pid) {
 	return pid;
     }
 
-    assign(state, pid, cmd.name);
-    const int fdout = stdout->fd();
-    const int fderr = stderr->fd();
+    /* The pidfd becomes readable when the child terminates, and is
+     * then used to reap it; no SIGCHLD, and no risk of the pid
+     * having been reused by then.
+     */
+    spider.read(pidfd, [this, pid] (int fd) { reap(fd, pid); });
 
-    ss.erase(fdout);
-    ss.erase(fderr);
+    p.pid = pid;
+    p.pidfd = pidfd;
+    groups[pid] = &p;
+    p.started = std::chrono::steady_clock::now();
+    p.starting = true;
+    nstarting++;
+    pids.emplace(pid, &p);
+    p.ready_in = {};
+    p.status.clear();
 
-    ss.emplace(fdout, Stream {cmd.name, "stdout", std::move(stdout)});
-    ss.emplace(fderr, Stream {cmd.name, "stderr", std::move(stderr)});
+    if (interval) {
+	std::fill(begin(p.over), end(p.over), std::chrono::steady_clock::time_point {});
+	p.proc = std::make_unique<ProcStat>(pid);
+	p.samples.clear();
+	ProcStat::Sample sample;
+	if (p.proc->sample(sample)) p.samples.add(sample);
+    }
 
-    reg(fdout, [&] (int fd) { read(fd); });
-    reg(fderr, [&] (int fd) { read(fd); });
+    auto add = [&] (const char* sname, std::unique_ptr<Pipe> pipe) {
+	Stream& s = p.streams.emplace_back(p, sname, std::move(pipe));
+	spider.stream(s.pipe->fd(),
+		      [this, s = &s] (int fd, const char* a, size_t n) {
+			  read(*s, fd, a, n);
+		      });
+    };
+    add("stdout", std::move(stdout));
+    add("stderr", std::move(stderr));
 
+    /* spawn() returns once the child has exec'd, and unless it's
+     * going to tell us when it's ready, that's as ready as we can
+     * tell. If it failed to, it's not ready, and it stops counting
+     * as starting when it's reaped.
+     */
+    if (execd && !p.notify) ready(p);
+    else if (execd && cmd.start_timeout) {
+	p.deadline = spider.after(std::chrono::seconds {cmd.start_timeout},
+				  [this, &p] { late(p); });
+    }
     return pid;
 }
 
 /**
- * Start 'name', if it isn't running already.
+ * Start 'name', if it isn't running already, or the instances of it
+ * which aren't.
  */
 void Parent::start(std::ostream& os, const Name& name)
 {
-    auto pid = key_of(state, name);
-    if (pid) {
-	Warning{log} << "cannot start " << name << ": it appears to be running already " << pid;
+    const auto* v = programs(name);
+    if (!v) {
+	Err{log} << "cannot start " << name << ": not configured";
+	os << "error: " << name << " not configured";
+	return;
+    }
+
+    if (v->size() > 1) {
+	start(os, *v);
+	return;
+    }
+    start(os, *v->front());
+}
+
+/**
+ * Start everything scheduled.
+ */
+void Parent::start_all(std::ostream& os)
+{
+    std::vector<Program*> v;
+    for (Program& p : pp) v.push_back(&p);
+    start(os, v);
+}
+
+void Parent::start(std::ostream& os, Program& p)
+{
+    const Name& name = p.name;
+
+    if (p.pid) {
+	Warning{log} << "cannot start " << name << ": it appears to be running already " << p.pid;
 	os << "error: " << name << " already running";
 	return;
     }
 
-    const auto* const cmd = find(schedule, name);
-    if (!cmd) {
-	Err{log} << "cannot start " << name << ": not configured";
-	os << "error: " << name << " not configured";
+    if (p.queued) {
+	os << "error: " << name << " already queued to start";
+	return;
+    }
+
+    if (p.waiting) {
+	os << "error: " << name << " already waiting to start";
 	return;
     }
 
-    if (!start(*cmd)) {
+    reset(p);
+    want(p);
+    pump();
+
+    if (p.waiting) {
+	os << "ok waiting for";
+	for (const Program* dep : p.deps) {
+	    if (!dep->ready()) os << ' ' << dep->name;
+	}
+	return;
+    }
+
+    if (p.queued) {
+	os << "ok queued; " << queue.size() << " waiting to start";
+	return;
+    }
+
+    if (!p.pid) {
 	os << "error: " << name << " failed to start";
 	return;
     }
@@ -219,66 +552,298 @@ void Parent::start(std::ostream& os, const Name& name)
     os << "ok";
 }
 
-/**
- * Start everything scheduled.
- */
-void Parent::start_all(std::ostream& os)
+void Parent::start(std::ostream& os, const std::vector<Program*>& programs)
 {
-    unsigned n = 0;
+    std::vector<Program*> v;
 
-    for (const Command& cmd : schedule) {
+    for (Program* p : programs) {
+
+	if (p->pid || p->queued || p->waiting) continue;
+	reset(*p);
+	want(*p);
+	v.push_back(p);
+    }
+    pump();
 
-	if (key_of(state, cmd.name)) continue;
-	if (start(cmd)) n++;
+    unsigned n = 0;
+    unsigned waiting = 0;
+    for (Program* p : v) {
+	if (p->pid) n++;
+	if (p->waiting) waiting++;
     }
 
     os << "ok started " << n << " programs";
+    if (queue.size()) {
+	os << "; " << queue.size() << " waiting to start";
+    }
+    if (waiting) {
+	os << "; " << waiting << " waiting for others";
+    }
 }
 
-void Parent::stop(std::ostream& os, const Name& name) const
+/**
+ * Stop 'name' (all instances of it), or cancel its pending start or
+ * restart. With a Waiter, reply through it once it has exited,
+ * rather than at once.
+ */
+bool Parent::stop(std::ostream& os, const Name& name, Waiter w)
 {
-    if (!find(schedule, name)) {
+    const auto* v = programs(name);
+    if (!v) {
 	os << "error " << name << ": not configured";
-	return;
+	return false;
     }
 
-    const auto pid = key_of(state, name);
-    if (!pid) {
+    if (v->size() > 1) return stop(os, *v, w);
+    return stop(os, *v->front(), w);
+}
+
+bool Parent::stop_all(std::ostream& os, Waiter w)
+{
+    std::vector<Program*> v;
+    for (Program& p : pp) v.push_back(&p);
+    return stop(os, v, w);
+}
+
+bool Parent::stop(std::ostream& os, Program& p, Waiter w)
+{
+    const Name& name = p.name;
+
+    if (p.old.pid) retire(p);
+
+    if (!p.pid && p.restart) {
+	reset(p);
+	os << "ok cancelled restart of " << name;
+	return false;
+    }
+
+    if (!p.pid && (p.waiting || p.queued)) {
+	reset(p);
+	os << "ok cancelled start of " << name;
+	return false;
+    }
+
+    if (!p.pid) {
 	os << "error cannot stop " << name << ": it is not running";
-	return;
+	return false;
     }
 
-    Info{log} << "sending SIGINT to " << name << ' ' << pid;
+    if (!signal(os, p)) return false;
 
-    if (kill(pid.val, SIGINT) == -1) {
-	os << "error cannot kill " << name << ": " << std::strerror(errno);
-	return;
+    if (!w) {
+	os << "ok";
+	return false;
     }
 
-    os << "ok";
+    p.waiters.push_back(std::move(w));
+    return true;
+}
+
+bool Parent::stop(std::ostream& os, const std::vector<Program*>& programs, Waiter w)
+{
+    std::vector<Program*> v;
+    unsigned cancelled = 0;
+
+    for (Program* p : programs) {
+
+	if (!p->pid && (p->queued || p->waiting || p->restart)) cancelled++;
+	reset(*p);
+	if (p->old.pid) retire(*p);
+	if (!p->pid) continue;
+	if (!signal(os, *p)) return false;
+	v.push_back(p);
+    }
+
+    const std::string cancels = "cancelled " + std::to_string(cancelled) + " pending starts";
+
+    if (!w || v.empty()) {
+	os << "ok";
+	if (cancelled) os << ' ' << cancels;
+	return false;
+    }
+
+    auto left = std::make_shared<size_t>(v.size());
+    std::string reply = "ok stopped " + std::to_string(v.size()) + " programs";
+    if (cancelled) reply += "; " + cancels;
+    for (Program* p : v) {
+	p->waiters.push_back([w, left, reply] (const std::string&) {
+	    if (--*left==0) w(reply);
+	});
+    }
+    return true;
 }
 
-void Parent::stop_all(std::ostream& os) const
+/**
+ * Send the stop signal to 'p' (which is running), and arrange for
+ * SIGKILL if it hasn't exited in time.
+ */
+bool Parent::signal(std::ostream& os, Program& p)
 {
-    for (const auto& e : state) {
+    const Command& cmd = p.cmd;
+
+    reset(p);
+    p.stopping = true;
+    Info{log} << "sending " << signame(cmd.stop_signal) << " to " << p.name << ' ' << p.pid;
+
+    if (kill_group(p.pid, cmd.stop_signal) == -1) {
+	os << "error cannot kill " << p.name << ' ' << p.pid
+	   << ": " << std::strerror(errno);
+	return false;
+    }
+
+    if (cmd.stop_timeout && !p.escalate) {
+	p.escalate = spider.after(std::chrono::seconds {cmd.stop_timeout},
+				  [this, &p] { kill(p); });
+    }
+    return true;
+}
 
-	const Pid& pid = e.first;
-	const Name& name = e.second;
+/**
+ * Replace 'name' without a gap: start a new process alongside the
+ * running one, and stop the old one once the new one is ready (at
+ * once, unless it notifies). If the new one exits before that, the
+ * old one stays. If it's not running, this is just a start. With
+ * instances, each is replaced like that, all at once.
+ */
+void Parent::replace(std::ostream& os, const Name& name)
+{
+    const auto* v = programs(name);
+    if (!v) {
+	os << "error: " << name << " not configured";
+	return;
+    }
 
-	Info{log} << "sending SIGINT to " << name << ' ' << pid;
+    if (v->size()==1) {
+	replace(os, *v->front());
+	return;
+    }
 
-	if (kill(pid.val, SIGINT) == -1) {
-	    os << "error cannot kill " << name << ' ' << pid
-	       << ": " << std::strerror(errno);
+    unsigned n = 0;
+    for (Program* p : *v) {
+	std::ostringstream reply;
+	replace(reply, *p);
+	if (reply.str().compare(0, 2, "ok")) {
+	    os << reply.str();
 	    return;
 	}
+	n++;
     }
+    os << "ok replacing " << n << " programs";
+}
 
-    os << "ok";
+void Parent::replace(std::ostream& os, Program& p)
+{
+    const Name& name = p.name;
+
+    if (!p.pid) {
+	start(os, p);
+	return;
+    }
+
+    if (p.old.pid) {
+	os << "error: " << name << " already being replaced";
+	return;
+    }
+
+    if (p.starting || p.stopping) {
+	os << "error: " << name << " is still "
+	   << (p.starting ? "starting" : "stopping");
+	return;
+    }
+
+    Program::Old& old = p.old;
+    old.pid = p.pid;
+    old.pidfd = p.pidfd;
+    old.started = p.started;
+    old.ready_in = p.ready_in;
+    old.status = p.status;
+    p.pid = {};
+    p.pidfd = -1;
+    p.proc.reset();
+    reset(p);
+
+    Info{log} << "replacing " << name << ' ' << old.pid;
+    const Pid prev = old.pid;
+    if (!start(p)) {
+	reinstate(p);
+	os << "error: " << name << " failed to start";
+	return;
+    }
+    os << "ok " << name << ' ' << p.pid << " replacing " << prev;
+}
+
+/**
+ * Stop the process 'p' is replacing, like stop does.
+ */
+void Parent::retire(Program& p)
+{
+    using namespace std::chrono;
+    const Command& cmd = p.cmd;
+    Program::Old& old = p.old;
+    if (old.stopping) return;
+    old.stopping = true;
+
+    Info{log} << "sending " << signame(cmd.stop_signal) << " to " << p.name << ' ' << old.pid;
+    if (kill_group(old.pid, cmd.stop_signal) == -1) {
+	Err{log} << "cannot kill " << p.name << ' ' << old.pid
+		 << ": " << std::strerror(errno);
+	return;
+    }
+
+    if (cmd.stop_timeout) {
+	old.escalate = spider.after(seconds {cmd.stop_timeout}, [this, &p] {
+	    p.old.escalate = {};
+	    Warning{log} << p.name << ' ' << p.old.pid << " still running after "
+			 << p.cmd.stop_timeout << " s; sending SIGKILL";
+	    kill_group(p.old.pid, SIGKILL);
+	});
+    }
 }
 
 /**
- * List the schedule, and the pid for each running program.
+ * The new process for 'p' is gone before it was ready, or never
+ * started, so the one it was to replace stays on.
+ */
+void Parent::reinstate(Program& p)
+{
+    Program::Old& old = p.old;
+    Warning{log} << "replacing " << p.name << " failed; keeping " << old.pid;
+
+    p.pid = old.pid;
+    p.pidfd = old.pidfd;
+    p.started = old.started;
+    p.ready_in = old.ready_in;
+    p.status = old.status;
+    p.pinged = std::chrono::steady_clock::now();
+    p.stopping = false;
+    p.again = false;
+    old = {};
+
+    if (interval) {
+	std::fill(begin(p.over), end(p.over), std::chrono::steady_clock::time_point {});
+	p.proc = std::make_unique<ProcStat>(p.pid);
+	p.samples.clear();
+    }
+}
+
+/**
+ * 'p' didn't exit in time after being told to stop.
+ */
+void Parent::kill(Program& p)
+{
+    p.escalate = {};
+    if (!p.pid) return;
+
+    Warning{log} << p.name << ' ' << p.pid << " still running after "
+		 << p.cmd.stop_timeout << " s; sending SIGKILL";
+    kill_group(p.pid, SIGKILL);
+}
+
+/**
+ * List the schedule, and the pid for each running program, and where
+ * it's placed if that's restricted. Programs which aren't running may
+ * be queued to start, waiting for others to start first, waiting to
+ * restart, or crashing too much to be restarted.
  */
 void Parent::list(std::ostream& os) const
 {
@@ -293,61 +858,552 @@ void Parent::list(std::ostream& os) const
 	return buf;
     };
 
-    for (auto& cmd : schedule) {
-	os << str(key_of(state, cmd.name)) << "  " << cmd.name << "\r\n";
+    const auto now = std::chrono::steady_clock::now();
+
+    for (const Program& p : pp) {
+	os << str(p.pid) << "  " << p.name;
+	if (!p.where.empty()) {
+	    os << "  [" << p.where << ']';
+	}
+	if (p.queued) {
+	    os << "  (queued)";
+	}
+	else if (p.waiting) {
+	    os << "  (waiting for";
+	    for (const Program* dep : p.deps) {
+		if (!dep->ready()) os << ' ' << dep->name;
+	    }
+	    os << ')';
+	}
+	else if (p.pid && p.starting) {
+	    const std::chrono::duration<double> d = now - p.started;
+	    char buf[40];
+	    std::snprintf(buf, sizeof buf, "  (starting for %.1f s)", d.count());
+	    os << buf;
+	}
+	else if (p.pid && p.notify) {
+	    const std::chrono::duration<double> d = p.ready_in;
+	    char buf[40];
+	    std::snprintf(buf, sizeof buf, "  (ready in %.2f s)", d.count());
+	    os << buf;
+	}
+	else if (p.restart) {
+	    const std::chrono::duration<double> d = p.restart_at - now;
+	    char buf[40];
+	    std::snprintf(buf, sizeof buf, "  (restart in %.1f s; crashed %u)",
+			  std::max(d.count(), 0.0), p.crashes);
+	    os << buf;
+	}
+	else if (p.broken) {
+	    os << "  (crashing; not restarted)";
+	}
+	if (p.old.pid) {
+	    os << "  (" << (p.old.stopping ? "stopping " : "replacing ")
+	       << p.old.pid << ')';
+	}
+	if (p.pid && p.status.size()) {
+	    os << "  " << p.status;
+	}
+	os << "\r\n";
+    }
+}
+
+/**
+ * Resource usage for each program, over all the times it has run.
+ */
+void Parent::usage(std::ostream& os) const
+{
+    for (const Program& p : pp) usage(os, p);
+}
+
+bool Parent::usage(std::ostream& os, const Name& name) const
+{
+    const auto* v = programs(name);
+    if (!v) {
+	os << "error: " << name << " not configured";
+	return false;
+    }
+    for (const Program* p : *v) {
+	usage(os, *p);
+	live(os, *p);
+    }
+    return true;
+}
+
+/**
+ * Helper, rendering as e.g.
+ *   foo: runs 3; user 1.50 s; sys 0.02 s; maxrss 2048 kB; minflt 160; ...
+ * plus, if it has a cgroup, what the cgroup says about all its
+ * processes: CPU time and, with the memory controller, peak usage.
+ */
+void Parent::usage(std::ostream& os, const Program& p) const
+{
+    const Usage& u = p.total;
+    auto sec = [] (std::chrono::microseconds us) {
+	char buf[30];
+	std::snprintf(buf, sizeof buf, "%.2f s", us.count() / 1e6);
+	return std::string {buf};
+    };
+
+    os << p.name << ": runs " << u.runs
+       << "; user " << sec(u.user)
+       << "; sys " << sec(u.sys)
+       << "; maxrss " << u.maxrss << " kB"
+       << "; minflt " << u.minflt
+       << "; majflt " << u.majflt
+       << "; nvcsw " << u.nvcsw
+       << "; nivcsw " << u.nivcsw;
+
+    const std::string usec = cgroups.read(p.cmd, "cpu.stat", "usage_usec");
+    if (usec.size()) {
+	os << "; cgroup cpu " << sec(std::chrono::microseconds {std::atol(usec.c_str())});
+    }
+    const std::string peak = cgroups.read(p.cmd, "memory.peak");
+    if (peak.size()) {
+	os << "; cgroup memory.peak " << std::atoll(peak.c_str()) / 1024 << " kB";
+    }
+    os << "\r\n";
+}
+
+/**
+ * Helper, rendering what the samples say about 'p' if it's running,
+ * as e.g.
+ *   foo [4711]: rss 10240 kB
+ *   10.0 s: cpu 12.5 %; read 0.0 kB/s; write 3.5 kB/s
+ *   60.0 s: cpu 11.0 %; read 0.0 kB/s; write 3.1 kB/s
+ * where the windows are shorter, or fewer, while there are few
+ * samples.
+ */
+void Parent::live(std::ostream& os, const Program& p) const
+{
+    using namespace std::chrono_literals;
+    if (!p.pid || p.samples.empty()) return;
+
+    os << p.name << ' ' << p.pid << ": rss "
+       << p.samples.latest().rss / 1024 << " kB\r\n";
+
+    Samples::Duration prev {};
+    for (auto window : {10s, 60s}) {
+	const auto r = p.samples.rate(window);
+	if (r.d==prev) break;
+	prev = r.d;
+	char buf[100];
+	std::snprintf(buf, sizeof buf,
+		      "%.1f s: cpu %.1f %%; read %.1f kB/s; write %.1f kB/s\r\n",
+		      std::chrono::duration<double>(r.d).count(),
+		      r.cpu, r.read / 1024, r.write / 1024);
+	os << buf;
+    }
+}
+
+/**
+ * Sample every running process, all in one go, and do it again in a
+ * while.
+ */
+void Parent::sample()
+{
+    for (auto& pid : pids) {
+	Program& p = *pid.second;
+	if (!(pid.first==p.pid)) continue;
+	ProcStat::Sample sample;
+	if (p.proc && p.proc->sample(sample)) {
+	    p.samples.add(sample);
+	    watch(p);
+	}
+    }
+    sampler = spider.after(std::chrono::seconds {interval}, [this] { sample(); });
+}
+
+/**
+ * Check 'p' against its watchdog rules, right after a sample, and act
+ * on the first one which has been exceeded for long enough. Memory is
+ * as sampled; CPU usage since the previous sample; notifications
+ * since the last WATCHDOG=1 (or READY=1), once it's ready.
+ */
+void Parent::watch(Program& p)
+{
+    using namespace std::chrono;
+    using Watchdog = Command::Watchdog;
+    if (p.stopping) return;
+
+    const auto now = p.samples.latest().t;
+    const auto& rules = p.cmd.watchdog;
+
+    for (size_t i = 0; i < rules.size(); i++) {
+	const Watchdog& w = rules[i];
+	auto& since = p.over[i];
+
+	double val = 0;
+	switch (w.metric) {
+	case Watchdog::Metric::rss:
+	    val = p.samples.latest().rss;
+	    break;
+	case Watchdog::Metric::cpu: {
+	    const auto r = p.samples.rate(seconds {interval});
+	    if (r.d==r.d.zero()) continue;
+	    val = r.cpu;
+	    break;
+	}
+	case Watchdog::Metric::notify:
+	    if (p.starting) continue;
+	    val = duration<double>(now - p.pinged).count();
+	    break;
+	}
+
+	if (val <= w.limit) {
+	    since = {};
+	    continue;
+	}
+	if (since==steady_clock::time_point {}) since = now;
+	const duration<double> d = now - since;
+	if (d < seconds {w.duration}) continue;
+	since = {};
+
+	auto str = [&w] (double val) {
+	    char buf[30];
+	    switch (w.metric) {
+	    case Watchdog::Metric::rss:
+		std::snprintf(buf, sizeof buf, "%.1f MB", val / (1024 * 1024));
+		break;
+	    case Watchdog::Metric::cpu:
+		std::snprintf(buf, sizeof buf, "%.1f %%", val);
+		break;
+	    case Watchdog::Metric::notify:
+		std::snprintf(buf, sizeof buf, "%.1f s", val);
+		break;
+	    }
+	    return std::string {buf};
+	};
+	const char* const metric[] = {"rss ", "cpu ", "no WATCHDOG=1 for "};
+	Warning{log} << p.name << ' ' << p.pid << ": watchdog: "
+		     << metric[int(w.metric)] << str(val)
+		     << " over the limit " << str(w.limit)
+		     << " for " << std::lround(d.count()) << " s";
+
+	std::ostringstream os;
+	switch (w.action) {
+	case Watchdog::Action::restart:
+	    if (!signal(os, p)) break;
+	    p.again = true;
+	    return;
+	case Watchdog::Action::stop:
+	    signal(os, p);
+	    return;
+	case Watchdog::Action::signal:
+	    Info{log} << "sending " << signame(w.signal) << " to " << p.name << ' ' << p.pid;
+	    if (pidfd_kill(p.pidfd, w.signal) == -1) {
+		os << "error cannot kill " << p.name << ' ' << p.pid
+		   << ": " << std::strerror(errno);
+	    }
+	    break;
+	}
+	if (os.str().size()) Err{log} << os.str();
+	return;
     }
 }
 
+void Parent::Usage::add(const rusage& ru)
+{
+    runs++;
+    user += us(ru.ru_utime);
+    sys += us(ru.ru_stime);
+    maxrss = std::max(maxrss, ru.ru_maxrss);
+    minflt += ru.ru_minflt;
+    majflt += ru.ru_majflt;
+    nvcsw += ru.ru_nvcsw;
+    nivcsw += ru.ru_nivcsw;
+}
+
 /**
- * Reap any children which have terminated. The name is a bit
- * misleading: the call doesn't block.
+ * Reap a child whose pidfd has become readable, i.e. which has
+ * terminated.
  *
  * The streams cannot sensibly be closed: the child might have forked
- * and some grandchild might still want to write.
+ * and some grandchild might still want to write. That stops once
+ * sweep() has seen to them.
+ */
+void Parent::reap(int pidfd, Pid pid)
+{
+    siginfo_t info = {};
+    rusage ru = {};
+    const int err = waitid(pidfd, info, ru) ? errno : 0;
+    if (err==EINTR) return;
+    if (!err && !info.si_pid) return;
+
+    spider.forget(pidfd);
+    close(pidfd);
+
+    auto it = pids.find(pid);
+    if (it==end(pids)) return;
+    Program& p = *it->second;
+    pids.erase(it);
+    const bool old = pid==p.old.pid;
+    if (old) {
+	if (p.old.escalate) spider.cancel(p.old.escalate);
+	p.old = {};
+    }
+    else {
+	p.pid = {};
+	p.pidfd = -1;
+	p.proc.reset();
+	if (p.escalate) spider.cancel(p.escalate);
+	p.escalate = {};
+    }
+
+    /* Those waiting for it to stop want the process it was
+     * replacing gone too, or vice versa.
+     */
+    const bool gone = !p.pid && !p.old.pid;
+
+    const Name& name = p.name;
+    std::ostringstream how;
+    if (err) {
+	how << "cannot reap: " << std::strerror(err);
+	Warning{log} << name << ' ' << pid << ": " << how.str();
+    }
+    else {
+	how << info;
+	Info{log} << name << ' ' << pid << ": " << how.str();
+	p.total.add(ru);
+    }
+
+    sweep(p, pid);
+
+    /* A replaced process just goes away. A replacement which didn't
+     * make it leaves the old one in its place, rather than being
+     * restarted.
+     */
+    if (!old) {
+	/* Before exited(), which may start it again.
+	 */
+	ready(p);
+	if (p.old.pid && !p.old.stopping) reinstate(p);
+	else if (!err) exited(p, info);
+    }
+
+    /* Last, since a waiter may well do things to us.
+     */
+    if (!gone) return;
+    std::ostringstream reply;
+    reply << "ok " << name << ' ' << pid << ": " << how.str();
+    const auto waiters = std::move(p.waiters);
+    p.waiters.clear();
+    for (auto& w : waiters) w(reply.str());
+}
+
+/**
+ * There's a SIGCHLD: something we're the parent of has terminated.
+ * Usually it's a program, which its pidfd tells us about too, but
+ * as a subreaper we also inherit what a program leaves behind, and
+ * have to reap that. One at a time, since waitid() can't skip the
+ * programs.
  */
-void Parent::wait()
+void Parent::reaper(int fd)
 {
-    siginfo_t info;
-    while (waitid(P_ALL, 0, &info, WEXITED | WNOHANG) != -1 && info.si_pid) {
+    signalfd_siginfo si;
+    while (::read(fd, &si, sizeof si)==sizeof si) ;
+
+    while (true) {
+	siginfo_t info = {};
+	if (::waitid(P_ALL, 0, &info, WEXITED | WNOHANG | WNOWAIT)) return;
+	if (!info.si_pid) return;
 
-	const Pid pid {info.si_pid};
-	auto it = state.find(pid);
-	if (it != end(state)) {
-	    const Name name = it->second;
-	    state.erase(it);
-	    Info{log} << name << ' ' << pid<< ": " << info;
+	const Pid pid = info.si_pid;
+	auto it = pids.find(pid);
+	if (it != end(pids)) {
+	    Program& p = *it->second;
+	    reap(pid==p.old.pid ? p.old.pidfd : p.pidfd, pid);
 	}
-	else {
-	    /* Not sure why we'd be notified about a process
-	     * terminating when we don't remember forking it, but
-	     * anyway:
-	     */
-	    Warning{log} << pid << " (unknown): " << info;
+	else if (!stray(pid)) {
+	    return;
 	}
     }
 }
 
 /**
- * A stdout or stderr pipe has become readable, which might mean
- * there's new text on it, or that it has closed.
+ * Reap something a program left behind, knowing the program by its
+ * process group.
  */
-void Parent::read(int fd)
+bool Parent::stray(Pid pid)
 {
-    const auto it = ss.find(fd);
-    if (it==end(ss)) return;
-    Stream& stream = it->second;
+    const Pid pgid = getpgid(pid.val);
+    siginfo_t info = {};
+    if (::waitid(P_PID, pid.val, &info, WEXITED | WNOHANG)) return false;
 
-    stream.text.feed(fd);
+    auto it = groups.find(pgid);
+    if (it==end(groups)) {
+	Info{log} << "reaped " << pid << " (not from any program): " << info;
+	return true;
+    }
 
-    char* a; char* b;
-    while (stream.text.read(a, b)) {
-	std::string s {a, b};
-	if (s.size() && s.back()=='\n') s.pop_back();
-	Info{log} << stream.pname << ": " << stream.sname << ": " << s;
+    Program& p = *it->second;
+    Info{log} << p.name << ": " << pid << " left behind by " << pgid << ": " << info;
+    if (!(p.pid==pgid) && !(p.old.pid==pgid) && kill_group(pgid, 0)) {
+	groups.erase(it);
     }
+    return true;
+}
+
+/**
+ * The process 'pgid' of 'p' has exited. Send the stop signal to any
+ * processes it left behind in its group, and SIGKILL if they're
+ * still there after the stop timeout, so that they don't pile up.
+ */
+void Parent::sweep(Program& p, Pid pgid)
+{
+    using namespace std::chrono;
+    const Command& cmd = p.cmd;
+    if (kill_group(pgid, 0)) {
+	groups.erase(pgid);
+	return;
+    }
+
+    Info{log} << "sending " << signame(cmd.stop_signal) << " to what "
+	      << p.name << ' ' << pgid << " left behind";
+    kill_group(pgid, cmd.stop_signal);
+    if (!cmd.stop_timeout) return;
+
+    spider.after(seconds {cmd.stop_timeout}, [this, &p, pgid] {
+	auto it = groups.find(pgid);
+	if (it==end(groups) || it->second != &p) return;
+	if (p.pid==pgid || p.old.pid==pgid) return;
+	if (kill_group(pgid, 0)) return;
+	Warning{log} << "what " << p.name << ' ' << pgid << " left behind is still running after "
+		     << p.cmd.stop_timeout << " s; sending SIGKILL";
+	kill_group(pgid, SIGKILL);
+    });
+}
+
+/**
+ * Restart 'p' after it has exited, if that's its policy, and unless
+ * it was told to stop or has been crashing too much.
+ */
+void Parent::exited(Program& p, const siginfo_t& info)
+{
+    using namespace std::chrono;
+    using Restart = Command::Restart;
+
+    const bool stopping = p.stopping;
+    const bool again = p.again;
+    p.stopping = false;
+    p.again = false;
+    if (again) {
+	want(p);
+	pump();
+	return;
+    }
+    if (stopping) return;
+
+    const bool failed = info.si_code!=CLD_EXITED || info.si_status;
+    switch (p.cmd.restart) {
+    case Restart::never: return;
+    case Restart::on_failure: if (!failed) return; break;
+    case Restart::always: break;
+    }
+
+    const auto now = steady_clock::now();
+    if (now - p.started < quick) {
+	p.crashes++;
+    }
+    else {
+	p.crashes = 0;
+    }
+
+    const Name& name = p.name;
+    if (p.crashes >= limit) {
+	p.broken = true;
+	Err{log} << name << ": exited quickly " << p.crashes
+		 << " times in a row; not restarting it";
+	return;
+    }
+
+    if (!p.crashes) {
+	want(p);
+	pump();
+	return;
+    }
+
+    milliseconds d = first * (1u << std::min(p.crashes - 1, 16u));
+    d = std::min<milliseconds>(d, longest);
+    d -= milliseconds {std::uniform_int_distribution<long> {0, d.count() / 2}(rng)};
+
+    Info{log} << name << ": restarting in " << duration<double>(d).count() << " s";
+    p.restart_at = now + d;
+    p.restart = spider.after(d, [this, &p] {
+	p.restart = {};
+	want(p);
+	pump();
+    });
+}
+
+/**
+ * Forget about 'p' crashing, and any pending restart or start; used
+ * when someone explicitly starts or stops it.
+ */
+void Parent::reset(Program& p)
+{
+    if (p.restart) spider.cancel(p.restart);
+    p.restart = {};
+    p.crashes = 0;
+    p.broken = false;
+    p.again = false;
+    p.waiting = false;
+    if (p.queued) {
+	queue.erase(std::find(begin(queue), end(queue), &p));
+	p.queued = false;
+    }
+}
+
+namespace {
+
+    /* Log a line [a, b) from a program's stdout or stderr, or a piece
+     * of one, as "name: stdout: text". If the log would truncate it,
+     * log it in pieces, the later ones tagged "stdout+".
+     */
+    void log_line(Syslog& log,
+		  const Name& pname, const char* sname, bool partial,
+		  const char* a, const char* b)
+    {
+	const size_t prefix = pname.size() + std::strlen(sname) + 5;
+	const size_t n = Syslog::capacity > prefix + 80
+	    ? Syslog::capacity - prefix
+	    : 80;
+	do {
+	    const char* c = b - a > std::ptrdiff_t(n) ? a + n : b;
+	    Info{log} << pname << ": " << sname << (partial ? "+: " : ": ")
+		      << std::string {a, c};
+	    partial = true;
+	    a = c;
+	} while (a != b);
+    }
+}
+
+/**
+ * There's new text on a stdout or stderr pipe, or (n = 0) it has
+ * closed. A line too long for the TextReader, or for the log, is
+ * logged in pieces, the ones after the first tagged like "stdout+".
+ */
+void Parent::read(Stream& stream, int fd, const char* a, size_t n)
+{
+    const Name& pname = stream.program.name;
+    const char* const b = a + n;
+    do {
+	a += stream.text.feed(a, b);
+
+	char* p; char* q;
+	while (stream.text.read(p, q)) {
+	    const bool partial = stream.partial;
+	    stream.partial = q[-1] != '\n';
+	    if (!stream.partial) q--;
+	    log_line(log, pname, stream.sname, partial, p, q);
+	    st.lines++;
+	}
+    } while (a != b && !stream.text.eof());
 
     if (stream.text.eof()) {
-	Info{log} << stream.pname << ": " << stream.sname << ": EOF";
-	ss.erase(it);
+	Info{log} << pname << ": " << stream.sname << ": EOF";
+	spider.forget(fd);
+	auto& ss = stream.program.streams;
+	ss.remove_if([&] (const Stream& s) { return &s==&stream; });
     }
 }
@@ -9,9 +9,23 @@
 #include "pid.h"
 #include "pipes.h"
 #include "textread.h"
+#include "spider.h"
 #include "log.h"
+#include "cgroup.h"
+#include "placement.h"
+#include "procstat.h"
+#include "notify.h"
+#include "listen.h"
 
-#include <map>
+#include <signal.h>
+#include <sys/resource.h>
+
+#include <list>
+#include <deque>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <unordered_map>
 #include <functional>
 #include <memory>
 
@@ -21,43 +35,236 @@
  */
 class Parent {
 public:
+    /**
+     * Limits on starting programs, so that starting many doesn't
+     * turn into a thundering herd: how many may be starting at once,
+     * and how many may start per second. Zero means no limit.
+     */
+    struct Pace {
+	unsigned starting = 0;
+	unsigned rate = 0;
+    };
+
     Parent(const Schedule& schedule,
 	   Syslog& log,
-	   std::function<void(int, std::function<void(int)>)> outf);
+	   Spider& spider,
+	   Pace pace,
+	   const Cgroups& cgroups,
+	   const Sockets& sockets,
+	   unsigned interval);
 
     void shutdown();
 
     void start(std::ostream& os, const Name&);
     void start_all(std::ostream& os);
-    void stop(std::ostream& os, const Name&) const;
-    void stop_all(std::ostream& os) const;
+    /* For stopping and waiting: called with the reply once the
+     * program(s) have exited, if stop() returns true.
+     */
+    using Waiter = std::function<void(const std::string&)>;
+
+    bool stop(std::ostream& os, const Name&, Waiter w = {});
+    bool stop_all(std::ostream& os, Waiter w = {});
+    void replace(std::ostream& os, const Name&);
 
     void list(std::ostream& os) const;
+    void usage(std::ostream& os) const;
+    bool usage(std::ostream& os, const Name&) const;
 
-    void wait();
-    void read(int fd);
+    struct Stats {
+	unsigned long lines = 0;
+    };
+    const Stats& stats() const { return st; }
 
 private:
     const Schedule& schedule;
     Syslog& log;
-    const std::function<void(int, std::function<void(int)>)> reg;
+    Spider& spider;
+    Stats st;
+
+    struct Program;
 
-    std::map<Pid, Name> state;
+    /**
+     * Resource usage as from getrusage(2), summed over the exited
+     * processes of a program, except maxrss which is the largest.
+     */
+    struct Usage {
+	unsigned runs = 0;
+	std::chrono::microseconds user {};
+	std::chrono::microseconds sys {};
+	long maxrss = 0;
+	long minflt = 0;
+	long majflt = 0;
+	long nvcsw = 0;
+	long nivcsw = 0;
+
+	void add(const rusage& ru);
+    };
 
     struct Stream {
-	Stream(const Name& pname, const char* sname, std::unique_ptr<Pipe> pipe);
+	Stream(Program& program, const char* sname, std::unique_ptr<Pipe> pipe);
 	Stream(Stream&&) = default;
 	Stream(const Stream&) = delete;
 
-	const Name pname;
+	Program& program;
 	const char* const sname;
 	std::unique_ptr<Pipe> pipe;
 	sockutil::TextReader text;
+	bool partial = false;
+    };
+
+    /**
+     * A configured program (or one instance of it, named like
+     * name@0), and its process if it's running. The streams are those
+     * not at EOF yet, which may include some from a previous process.
+     */
+    struct Program {
+	Program(const Command& cmd, const Name& name, const Placement& where)
+	    : cmd {cmd}, name {name}, where {where}, over(cmd.watchdog.size())
+	{}
+
+	const Command& cmd;
+	Name name;
+	Placement where;
+	Pid pid;
+	int pidfd = -1;
+	bool queued = false;
+	bool starting = false;
+	bool waiting = false;
+	std::list<Stream> streams;
+
+	/* For restarting: when the process started, how many times in
+	 * a row it has exited quickly, if we've given up on it, and
+	 * the pending restart.
+	 */
+	std::chrono::steady_clock::time_point started;
+	unsigned crashes = 0;
+	bool broken = false;
+	bool stopping = false;
+	Spider::Timer restart;
+	std::chrono::steady_clock::time_point restart_at;
+
+	/* For stopping: SIGKILL if it doesn't exit in time, and the
+	 * ones waiting for it to exit.
+	 */
+	Spider::Timer escalate;
+	std::vector<Waiter> waiters;
+
+	Usage total;
+
+	/* For live figures while it runs, if we're sampling.
+	 */
+	std::unique_ptr<ProcStat> proc;
+	Samples samples {std::chrono::minutes {1}};
+
+	/* For the watchdog: since when each rule has been exceeded,
+	 * and if it's being stopped in order to start again.
+	 */
+	std::vector<std::chrono::steady_clock::time_point> over;
+	bool again = false;
+
+	/* The programs it starts after, and those which start after
+	 * it.
+	 */
+	std::vector<Program*> deps;
+	std::vector<Program*> dependents;
+
+	/* Variables we add to its environment, and the environment
+	 * with them, or empty for the one in the Command.
+	 */
+	std::vector<std::string> env;
+	std::vector<char*> envp;
+
+	/* For programs which notify: the socket, when it last said
+	 * READY=1 or WATCHDOG=1, how long it took to be ready, its
+	 * status, and the deadline for READY=1.
+	 */
+	std::unique_ptr<NotifySocket> notify;
+	std::chrono::steady_clock::time_point pinged;
+	std::chrono::steady_clock::duration ready_in {};
+	std::string status;
+	Spider::Timer deadline;
+
+	/* While it's being replaced: the process it had until then,
+	 * which is stopped once the new one is ready, and what we knew
+	 * about it in case the new one fails.
+	 */
+	struct Old {
+	    Pid pid;
+	    int pidfd = -1;
+	    std::chrono::steady_clock::time_point started;
+	    std::chrono::steady_clock::duration ready_in {};
+	    std::string status;
+	    bool stopping = false;
+	    Spider::Timer escalate;
+	} old;
+
+	bool ready() const { return pid && !starting; }
     };
 
-    std::map<int, Stream> ss;
+    /* One entry per Command and instance, in schedule order. Never
+     * resized after construction, so the indexes can point into it.
+     * The names are those of the programs, and of Commands with
+     * several instances.
+     */
+    std::vector<Program> pp;
+    std::unordered_map<Name, std::vector<Program*>> names;
+    std::unordered_map<Pid, Program*> pids;
+
+    /* The process groups of programs, by the pid which led them,
+     * for as long as they may have processes left in them.
+     */
+    std::unordered_map<Pid, Program*> groups;
+
+    const Cgroups& cgroups;
+    const Sockets& sockets;
+
+    /* Programs waiting to start, and the pacing of them.
+     */
+    const Pace pace;
+    std::deque<Program*> queue;
+    unsigned nstarting = 0;
+    std::chrono::steady_clock::time_point next_start;
+    Spider::Timer pacer;
+    bool pumping = false;
+
+    std::minstd_rand rng;
+
+    /* Sampling the running processes every so many seconds, or
+     * never.
+     */
+    const unsigned interval;
+    Spider::Timer sampler;
 
-    Pid start(const Command&);
+    const std::vector<Program*>* programs(const Name&) const;
+    void environment(Program&);
+    void notifier(Program&);
+    void notified(Program&);
+    void want(Program&);
+    void enqueue(Program&);
+    void pump();
+    void ready(Program&);
+    void late(Program&);
+    Pid start(Program&);
+    void start(std::ostream& os, Program&);
+    void start(std::ostream& os, const std::vector<Program*>&);
+    bool stop(std::ostream& os, Program&, Waiter w);
+    bool stop(std::ostream& os, const std::vector<Program*>&, Waiter w);
+    void replace(std::ostream& os, Program&);
+    void exited(Program&, const siginfo_t&);
+    void reset(Program&);
+    bool signal(std::ostream& os, Program&);
+    void retire(Program&);
+    void reinstate(Program&);
+    void kill(Program&);
+    void reap(int pidfd, Pid pid);
+    void reaper(int fd);
+    bool stray(Pid pid);
+    void sweep(Program&, Pid pgid);
+    void usage(std::ostream& os, const Program&) const;
+    void live(std::ostream& os, const Program&) const;
+    void sample();
+    void watch(Program&);
+    void read(Stream& stream, int fd, const char* a, size_t n);
 };
 
 #endif
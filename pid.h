@@ -7,6 +7,7 @@
 
 #include <sys/types.h>
 #include <iostream>
+#include <functional>
 
 /**
  * A slightly more convenient pid_t. Mostly, I dislike how -1 is
@@ -18,6 +19,7 @@ public:
     Pid(pid_t val) : val{val} {}
 
     bool operator< (const Pid& other) const { return val < other.val; }
+    bool operator== (const Pid& other) const { return val == other.val; }
     explicit operator bool () const { return val != -1; }
 
     std::ostream& put(std::ostream& os) const { return os << '[' << val << ']'; }
@@ -31,4 +33,11 @@ std::ostream& operator<< (std::ostream& os, const Pid& val)
     return val.put(os);
 }
 
+namespace std {
+    template <>
+    struct hash<Pid> {
+	size_t operator() (const Pid& pid) const { return hash<pid_t>{}(pid.val); }
+    };
+}
+
 #endif
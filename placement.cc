@@ -0,0 +1,196 @@
+/* Copyright (c) 2024 Jrgen Grahn
+ * All rights reserved.
+ *
+ */
+#include "placement.h"
+
+#include "split.h"
+
+#include <algorithm>
+#include <iterator>
+#include <fstream>
+#include <iostream>
+#include <cstdlib>
+#include <cctype>
+
+#include <sched.h>
+#include <dirent.h>
+
+namespace {
+
+    bool number(unsigned& n, const std::string& s, unsigned limit)
+    {
+	char* end;
+	const unsigned long val = std::strtoul(s.c_str(), &end, 10);
+	if (s.empty() || *end || !std::isdigit(s.front())) return false;
+	if (val >= limit) return false;
+	n = val;
+	return true;
+    }
+
+    /* The CPUs we may run on.
+     */
+    std::vector<unsigned> allowed()
+    {
+	std::vector<unsigned> v;
+	cpu_set_t set;
+	if (sched_getaffinity(0, sizeof set, &set)) return v;
+	for (unsigned cpu = 0; cpu < CPU_SETSIZE && cpu < max_cpus; cpu++) {
+	    if (CPU_ISSET(cpu, &set)) v.push_back(cpu);
+	}
+	return v;
+    }
+
+    std::vector<unsigned> intersection(const std::vector<unsigned>& a,
+				       const std::vector<unsigned>& b)
+    {
+	std::vector<unsigned> v;
+	std::set_intersection(begin(a), end(a), begin(b), end(b),
+			      std::back_inserter(v));
+	return v;
+    }
+}
+
+/**
+ * Parse a CPU list like "2-5,8" into sorted CPU numbers. False if
+ * it's malformed, or names a CPU beyond max_cpus.
+ */
+bool cpulist(std::vector<unsigned>& cpus, const std::string& s)
+{
+    std::vector<unsigned> v;
+    for (const auto& range : split(",", s)) {
+	const auto dash = range.find('-');
+	unsigned a, b;
+	if (dash==std::string::npos) {
+	    if (!number(a, range, max_cpus)) return false;
+	    b = a;
+	}
+	else {
+	    if (!number(a, range.substr(0, dash), max_cpus)) return false;
+	    if (!number(b, range.substr(dash + 1), max_cpus)) return false;
+	    if (b < a) return false;
+	}
+	for (unsigned cpu = a; cpu <= b; cpu++) v.push_back(cpu);
+    }
+    if (v.empty()) return false;
+
+    std::sort(begin(v), end(v));
+    v.erase(std::unique(begin(v), end(v)), end(v));
+    cpus = v;
+    return true;
+}
+
+/**
+ * Render as e.g. "cpus 2-5,8 node 1", "cpus 3" or "node 0".
+ */
+std::ostream& operator<< (std::ostream& os, const Placement& where)
+{
+    const auto& v = where.cpus;
+    const char* sep = "";
+    if (v.size()) {
+	os << "cpus ";
+	auto a = begin(v);
+	while (a != end(v)) {
+	    auto b = a + 1;
+	    while (b != end(v) && *b == *std::prev(b) + 1) b++;
+	    os << sep << *a;
+	    if (b - a > 1) os << '-' << *std::prev(b);
+	    sep = ",";
+	    a = b;
+	}
+	sep = " ";
+    }
+    if (where.node != -1) os << sep << "node " << where.node;
+    return os;
+}
+
+Topology::Topology()
+{
+    const auto ours = allowed();
+    const std::string base = "/sys/devices/system/node";
+
+    if (DIR* dir = opendir(base.c_str())) {
+	while (const dirent* d = readdir(dir)) {
+	    const std::string name = d->d_name;
+	    unsigned id;
+	    if (name.compare(0, 4, "node") || !number(id, name.substr(4), max_nodes)) continue;
+
+	    std::ifstream f {base + '/' + name + "/cpulist"};
+	    std::string s;
+	    std::getline(f, s);
+	    std::vector<unsigned> cpus;
+	    cpulist(cpus, s);
+	    nodes.push_back({int(id), intersection(cpus, ours)});
+	}
+	closedir(dir);
+	numa = nodes.size();
+    }
+
+    if (nodes.empty()) {
+	nodes.push_back({0, ours});
+    }
+
+    std::sort(begin(nodes), end(nodes),
+	      [] (const Node& a, const Node& b) { return a.id < b.id; });
+}
+
+/**
+ * The CPUs we may use in 'node', or none if there's no such node.
+ */
+std::vector<unsigned> Topology::cpus(int node) const
+{
+    for (const Node& n : nodes) {
+	if (n.id==node) return n.cpus;
+    }
+    return {};
+}
+
+/**
+ * The number of CPUs we may run on, over all nodes.
+ */
+unsigned Topology::size() const
+{
+    unsigned n = 0;
+    for (const Node& nd : nodes) n += nd.cpus.size();
+    return n;
+}
+
+/**
+ * Placement number 'n' in a sequence meant to spread programs evenly:
+ * on one CPU each, round-robin over the nodes, and/or with memory from
+ * one node each, round-robin. With both, the memory comes from the
+ * node the CPU is on. Nodes without usable CPUs (memory-only nodes,
+ * or ones our own affinity excludes) are left out.
+ */
+Placement Topology::spread(unsigned n, bool cpus, bool node) const
+{
+    std::vector<const Node*> nn;
+    for (const Node& nd : nodes) {
+	if (nd.cpus.size()) nn.push_back(&nd);
+    }
+    Placement where;
+    if (nn.empty()) return where;
+
+    if (cpus) {
+	/* Node 0's first CPU, node 1's first CPU, ..., node 0's
+	 * second CPU, and so on.
+	 */
+	std::vector<std::pair<int, unsigned>> order;
+	for (size_t i = 0; ; i++) {
+	    const size_t size = order.size();
+	    for (const Node* nd : nn) {
+		if (i < nd->cpus.size()) order.emplace_back(nd->id, nd->cpus[i]);
+	    }
+	    if (order.size()==size) break;
+	}
+	const auto& cpu = order[n % order.size()];
+	where.cpus = {cpu.second};
+	if (node && numa) where.node = cpu.first;
+    }
+    else if (node && numa) {
+	const Node& nd = *nn[n % nn.size()];
+	where.node = nd.id;
+	where.cpus = nd.cpus;
+    }
+    return where;
+}
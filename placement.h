@@ -0,0 +1,55 @@
+/* Copyright (c) 2024 Jrgen Grahn
+ * All rights reserved.
+ *
+ */
+#ifndef DJCL_PLACEMENT_H
+#define DJCL_PLACEMENT_H
+
+#include <string>
+#include <vector>
+#include <iosfwd>
+
+/**
+ * Where a program runs: on which CPUs, and with its memory from which
+ * NUMA node. No CPUs means any, and node -1 means any.
+ */
+struct Placement {
+    std::vector<unsigned> cpus;
+    int node = -1;
+
+    bool empty() const { return cpus.empty() && node==-1; }
+};
+
+std::ostream& operator<< (std::ostream& os, const Placement& where);
+
+/* Limits, so that the child can apply a Placement using fixed-size
+ * masks.
+ */
+constexpr unsigned max_cpus = 1024;
+constexpr unsigned max_nodes = 1024;
+
+bool cpulist(std::vector<unsigned>& cpus, const std::string& s);
+
+/**
+ * The NUMA nodes on this machine, and the CPUs in each which we may
+ * run on, as found in /sys and by sched_getaffinity(2). Without NUMA
+ * support it's a single node, and there's nothing to bind memory to.
+ */
+class Topology {
+public:
+    Topology();
+
+    std::vector<unsigned> cpus(int node) const;
+    unsigned size() const;
+    Placement spread(unsigned n, bool cpus, bool node) const;
+
+private:
+    struct Node {
+	int id;
+	std::vector<unsigned> cpus;
+    };
+    std::vector<Node> nodes;
+    bool numa = false;
+};
+
+#endif
@@ -0,0 +1,190 @@
+/* Copyright (c) 2024 Jrgen Grahn
+ * All rights reserved.
+ *
+ */
+#include "procstat.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+    int open(Pid pid, const char* name)
+    {
+	const std::string path = "/proc/" + std::to_string(pid.val) + '/' + name;
+	return ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    }
+
+    /* Read the whole of a small /proc file, or return the empty
+     * range.
+     */
+    template <size_t N>
+    const char* pread(int fd, char (&buf)[N])
+    {
+	if (fd==-1) return buf;
+	const ssize_t n = ::pread(fd, buf, N, 0);
+	if (n <= 0) return buf;
+	return buf + n;
+    }
+
+    const char* ws(const char* a, const char* b)
+    {
+	while (a!=b && *a==' ') a++;
+	return a;
+    }
+
+    /* Parse a number at 'a', and move past it (and whitespace).
+     */
+    bool number(unsigned long long& n, const char*& a, const char* b)
+    {
+	a = ws(a, b);
+	const char* c = a;
+	n = 0;
+	while (c!=b && *c >= '0' && *c <= '9') {
+	    n = n * 10 + (*c - '0');
+	    c++;
+	}
+	if (c==a) return false;
+	a = ws(c, b);
+	return true;
+    }
+
+    bool skip(unsigned n, const char*& a, const char* b)
+    {
+	while (n--) {
+	    a = ws(a, b);
+	    a = std::find(a, b, ' ');
+	    if (a==b) return false;
+	}
+	return true;
+    }
+}
+
+ProcStat::ProcStat(Pid pid)
+    : stat {open(pid, "stat")},
+      statm {open(pid, "statm")},
+      io {open(pid, "io")}
+{}
+
+ProcStat::~ProcStat()
+{
+    for (int fd : {stat, statm, io}) {
+	if (fd != -1) close(fd);
+    }
+}
+
+/**
+ * Take a sample, stamped with the current time. False if the process
+ * is gone (or was never there).
+ */
+bool ProcStat::sample(Sample& s) const
+{
+    s = {};
+    s.t = std::chrono::steady_clock::now();
+
+    char buf[4096];
+    const char* end = pread(stat, buf);
+    if (!parse_stat(s, buf, end)) return false;
+
+    end = pread(statm, buf);
+    parse_statm(s, buf, end);
+
+    end = pread(io, buf);
+    parse_io(s, buf, end);
+    return true;
+}
+
+/**
+ * Parse /proc/<pid>/stat, that is "pid (comm) state ..." where utime
+ * and stime are the 14th and 15th fields. The comm may contain
+ * anything, including spaces and parentheses, so the fields are
+ * counted from the last ')'.
+ */
+bool parse_stat(ProcStat::Sample& s, const char* a, const char* b)
+{
+    const auto rb = std::find(std::make_reverse_iterator(b),
+			      std::make_reverse_iterator(a), ')');
+    if (rb.base()==a) return false;
+    a = rb.base();
+
+    unsigned long long utime, stime;
+    if (!skip(11, a, b)) return false;
+    if (!number(utime, a, b)) return false;
+    if (!number(stime, a, b)) return false;
+    s.ticks = utime + stime;
+    return true;
+}
+
+/**
+ * Parse /proc/<pid>/statm: "size resident shared ..." in pages.
+ */
+bool parse_statm(ProcStat::Sample& s, const char* a, const char* b)
+{
+    static const unsigned long long pagesize = sysconf(_SC_PAGESIZE);
+    unsigned long long size, resident;
+    if (!number(size, a, b)) return false;
+    if (!number(resident, a, b)) return false;
+    s.rss = resident * pagesize;
+    return true;
+}
+
+/**
+ * Parse /proc/<pid>/io, lines like "read_bytes: 4096".
+ */
+bool parse_io(ProcStat::Sample& s, const char* a, const char* b)
+{
+    bool found = false;
+    while (a!=b) {
+	const char* eol = std::find(a, b, '\n');
+	const char* colon = std::find(a, eol, ':');
+	const std::string key {a, colon};
+	unsigned long long* const p = key=="read_bytes" ? &s.read
+				    : key=="write_bytes" ? &s.write
+				    : nullptr;
+	if (p && colon!=eol) {
+	    const char* c = colon + 1;
+	    found = number(*p, c, eol) || found;
+	}
+	a = eol==b ? b : eol + 1;
+    }
+    return found;
+}
+
+void Samples::add(const ProcStat::Sample& s)
+{
+    v.push_back(s);
+    while (v.size() > 2 && s.t - v[1].t >= longest) v.pop_front();
+}
+
+/**
+ * CPU use as a percentage of one CPU, and I/O in bytes per second,
+ * between the latest sample and the latest one at least 'window'
+ * before it, or the oldest one we have. 'd' says how long that
+ * actually was, and is zero if there's too little to go on.
+ */
+Samples::Rate Samples::rate(Duration window) const
+{
+    Rate r;
+    if (v.size() < 2) return r;
+
+    const auto& b = v.back();
+    auto it = std::find_if(v.rbegin(), v.rend(),
+			   [&] (auto& s) { return b.t - s.t >= window; });
+    const auto& a = it==v.rend() ? v.front() : *it;
+
+    using namespace std::chrono;
+    r.d = b.t - a.t;
+    const double sec = duration<double>(r.d).count();
+    if (sec <= 0) return r;
+
+    static const double hz = sysconf(_SC_CLK_TCK);
+    r.cpu = 100 * (b.ticks - a.ticks) / hz / sec;
+    r.read = (b.read - a.read) / sec;
+    r.write = (b.write - a.write) / sec;
+    return r;
+}
@@ -0,0 +1,77 @@
+/* Copyright (c) 2024 Jrgen Grahn
+ * All rights reserved.
+ *
+ */
+#ifndef DJCL_PROCSTAT_H
+#define DJCL_PROCSTAT_H
+
+#include "pid.h"
+
+#include <chrono>
+#include <deque>
+#include <iosfwd>
+
+/**
+ * How a process is doing, from /proc/<pid>/stat, statm and io: CPU
+ * time in clock ticks, resident memory, and I/O to storage. The files
+ * are opened once and kept open, so a sample costs three pread(2)s.
+ * Missing files (io needs ptrace access) read as zero.
+ *
+ * Since it's opened by pid, it's only meaningful while we hold a
+ * pidfd for the process and haven't reaped it.
+ */
+class ProcStat {
+public:
+    explicit ProcStat(Pid pid);
+    ~ProcStat();
+    ProcStat(const ProcStat&) = delete;
+    ProcStat& operator= (const ProcStat&) = delete;
+
+    struct Sample {
+	std::chrono::steady_clock::time_point t;
+	unsigned long long ticks = 0;
+	unsigned long long rss = 0;
+	unsigned long long read = 0;
+	unsigned long long write = 0;
+    };
+
+    bool sample(Sample& s) const;
+
+private:
+    const int stat;
+    const int statm;
+    const int io;
+};
+
+bool parse_stat(ProcStat::Sample& s, const char* a, const char* b);
+bool parse_statm(ProcStat::Sample& s, const char* a, const char* b);
+bool parse_io(ProcStat::Sample& s, const char* a, const char* b);
+
+/**
+ * Recent samples, enough to cover the longest window, and rates over
+ * windows ending with the latest sample.
+ */
+class Samples {
+public:
+    using Duration = std::chrono::steady_clock::duration;
+    explicit Samples(Duration longest) : longest {longest} {}
+
+    void add(const ProcStat::Sample& s);
+    void clear() { v.clear(); }
+    bool empty() const { return v.empty(); }
+    const ProcStat::Sample& latest() const { return v.back(); }
+
+    struct Rate {
+	Duration d {};
+	double cpu = 0;
+	double read = 0;
+	double write = 0;
+    };
+    Rate rate(Duration window) const;
+
+private:
+    const Duration longest;
+    std::deque<ProcStat::Sample> v;
+};
+
+#endif
@@ -6,9 +6,16 @@
 #include <cstring>
 #include <algorithm>
 #include <iterator>
+#include <cstdlib>
+
+#include <unistd.h>
+#include <signal.h>
+#include <sched.h>
+#include <linux/ioprio.h>
 
 Command::Command(const Name& name)
-    : name{name}
+    : name{name},
+      stop_signal{SIGINT}
 {}
 
 bool Command::valid() const
@@ -16,6 +23,72 @@ bool Command::valid() const
     return argv.size();
 }
 
+namespace {
+
+    std::string var(const std::string& s)
+    {
+	return s.substr(0, s.find('='));
+    }
+
+    const char* getenv(const std::vector<char*>& envp, const char* name)
+    {
+	const size_t n = std::strlen(name);
+	for (const char* s : envp) {
+	    if (std::strncmp(s, name, n)==0 && s[n]=='=') return s + n + 1;
+	}
+	return nullptr;
+    }
+}
+
+/**
+ * Build the Image, once the Command is complete. The environment is
+ * 'base' with our env settings added or replacing existing ones,
+ * like putenv(3) would have done, and the PATH search uses the
+ * resulting PATH, like execvp(3) would have done.
+ */
+void Command::prepare(char** base)
+{
+    image = {};
+    if (!valid()) return;
+
+    for (auto& s : argv) image.argv.push_back(s.data());
+    image.argv.push_back(nullptr);
+
+    if (env.size()) {
+	std::unordered_map<std::string, size_t> vars;
+	for (char** p = base; *p; p++) {
+	    vars.emplace(var(*p), image.envp.size());
+	    image.envp.push_back(*p);
+	}
+	for (auto& s : env) {
+	    auto it = vars.find(var(s));
+	    if (it==vars.end()) {
+		vars.emplace(var(s), image.envp.size());
+		image.envp.push_back(s.data());
+	    }
+	    else {
+		image.envp[it->second] = s.data();
+	    }
+	}
+    }
+
+    const std::string& file = argv.front();
+    if (file.find('/') != std::string::npos) {
+	image.path.push_back(file);
+    }
+    else {
+	const char* path = image.envp.size() ? getenv(image.envp, "PATH")
+					     : ::getenv("PATH");
+	if (!path) path = "/bin:/usr/bin";
+
+	for (auto& dir : split(":", std::string {path})) {
+	    image.path.push_back(dir.empty() ? file : dir + '/' + file);
+	}
+    }
+
+    if (image.envp.size()) image.envp.push_back(nullptr);
+}
+
 namespace {
 
     bool isws(unsigned char ch) { return std::isspace(ch); }
@@ -49,12 +122,16 @@ namespace {
 	return {a, b};
     }
 
-    /* Append an entry 'name', or use the last entry if it's 'name'.
+    /* Append an entry 'name', or use the existing one.
      */
-    Command& command(std::vector<Command>& v, const std::string& name)
+    Command& command(std::vector<Command>& v,
+		     std::unordered_map<Name, size_t>& index,
+		     const std::string& name)
     {
-	if (v.empty() || v.back().name != name) return v.emplace_back(name);
-	return v.back();
+	auto it = index.find(name);
+	if (it != index.end()) return v[it->second];
+	index.emplace(name, v.size());
+	return v.emplace_back(name);
     }
 
     void exec(Command& p, const std::string& val)
@@ -72,6 +149,271 @@ namespace {
 	p.cwd = val;
     }
 
+    void after(Command& p, const std::string& val)
+    {
+	for (auto& name : split(val)) p.after.push_back(name);
+    }
+
+    bool yes(bool& b, const std::string& val)
+    {
+	if (val=="yes")     b = true;
+	else if (val=="no") b = false;
+	else return false;
+	return true;
+    }
+
+    bool restart(Command& p, const std::string& val)
+    {
+	using Restart = Command::Restart;
+	if (val=="never")           p.restart = Restart::never;
+	else if (val=="on-failure") p.restart = Restart::on_failure;
+	else if (val=="always")     p.restart = Restart::always;
+	else return false;
+	return true;
+    }
+
+    /* A signal like "TERM", "SIGTERM" or "15".
+     */
+    bool signal(int& n, const std::string& val)
+    {
+	std::string name = val;
+	if (name.compare(0, 3, "SIG")==0) name.erase(0, 3);
+
+	for (int sig = 1; sig < NSIG; sig++) {
+	    const char* abbrev = sigabbrev_np(sig);
+	    if (abbrev && name==abbrev) {
+		n = sig;
+		return true;
+	    }
+	}
+
+	char* end;
+	const long sig = std::strtol(val.c_str(), &end, 10);
+	if (val.empty() || *end || sig < 1 || sig >= NSIG) return false;
+	n = sig;
+	return true;
+    }
+
+    bool stop_signal(Command& p, const std::string& val)
+    {
+	return signal(p.stop_signal, val);
+    }
+
+    bool timeout(unsigned& t, const std::string& val)
+    {
+	char* end;
+	const unsigned long n = std::strtoul(val.c_str(), &end, 10);
+	if (val.empty() || *end || n > 1000000) return false;
+	t = n;
+	return true;
+    }
+
+    bool number(int& n, const std::string& s, int lo, int hi)
+    {
+	char* end;
+	const long val = std::strtol(s.c_str(), &end, 10);
+	if (s.empty() || *end || val < lo || val > hi) return false;
+	n = val;
+	return true;
+    }
+
+    bool nice(Command& p, const std::string& val)
+    {
+	if (!number(p.nice, val, -20, 19)) return false;
+	p.renice = true;
+	return true;
+    }
+
+    /* A policy like "batch", or "fifo:50" with a priority. The
+     * realtime ones default to the lowest priority.
+     */
+    bool sched(Command& p, const std::string& val)
+    {
+	const auto colon = val.find(':');
+	const std::string name = val.substr(0, colon);
+	int policy;
+	if (name=="other")      policy = SCHED_OTHER;
+	else if (name=="fifo")  policy = SCHED_FIFO;
+	else if (name=="rr")    policy = SCHED_RR;
+	else if (name=="batch") policy = SCHED_BATCH;
+	else if (name=="idle")  policy = SCHED_IDLE;
+	else return false;
+
+	const bool realtime = policy==SCHED_FIFO || policy==SCHED_RR;
+	int prio = realtime ? 1 : 0;
+	if (colon != std::string::npos) {
+	    if (!realtime) return false;
+	    if (!number(prio, val.substr(colon + 1), 1, 99)) return false;
+	}
+	p.sched = policy;
+	p.sched_priority = prio;
+	return true;
+    }
+
+    /* A class and level like "be:7", or "idle", like for ionice(1).
+     * The level defaults to the middle one.
+     */
+    bool ioprio(Command& p, const std::string& val)
+    {
+	const auto colon = val.find(':');
+	const std::string name = val.substr(0, colon);
+	int klass;
+	if (name=="rt")        klass = IOPRIO_CLASS_RT;
+	else if (name=="be")   klass = IOPRIO_CLASS_BE;
+	else if (name=="idle") klass = IOPRIO_CLASS_IDLE;
+	else return false;
+
+	int level = klass==IOPRIO_CLASS_IDLE ? 0 : IOPRIO_NORM;
+	if (colon != std::string::npos) {
+	    if (klass==IOPRIO_CLASS_IDLE) return false;
+	    if (!number(level, val.substr(colon + 1), 0, IOPRIO_NR_LEVELS - 1)) return false;
+	}
+	p.ioprio = IOPRIO_PRIO_VALUE(klass, level);
+	return true;
+    }
+
+    bool cpus(Command& p, const std::string& val)
+    {
+	if (val=="auto") {
+	    p.auto_cpus = true;
+	    p.place.cpus.clear();
+	    return true;
+	}
+	p.auto_cpus = false;
+	return cpulist(p.place.cpus, val);
+    }
+
+    bool numa(Command& p, const std::string& val)
+    {
+	if (val=="auto") {
+	    p.auto_node = true;
+	    p.place.node = -1;
+	    return true;
+	}
+	char* end;
+	const unsigned long n = std::strtoul(val.c_str(), &end, 10);
+	if (val.empty() || *end || n >= max_nodes) return false;
+	p.auto_node = false;
+	p.place.node = n;
+	return true;
+    }
+
+    bool instances(Command& p, const std::string& val)
+    {
+	if (val=="auto") {
+	    p.auto_instances = true;
+	    return true;
+	}
+	int n;
+	if (!number(n, val, 1, 10000)) return false;
+	p.auto_instances = false;
+	p.instances = n;
+	return true;
+    }
+
+    /* A size like "2G", "512M" or "100k", or just bytes.
+     */
+    bool size(double& n, const std::string& val)
+    {
+	char* end;
+	n = std::strtod(val.c_str(), &end);
+	if (val.empty() || !std::isdigit(val.front())) return false;
+	const std::string unit {end};
+	double k = 1;
+	if (unit=="k" || unit=="K") k = 1024;
+	else if (unit=="M")         k = 1024 * 1024;
+	else if (unit=="G")         k = 1024 * 1024 * 1024;
+	else if (unit=="T")         k = 1024.0 * 1024 * 1024 * 1024;
+	else if (unit.size()) return false;
+	n *= k;
+	return n > 0;
+    }
+
+    /* A duration like "60s", "5m" or "1h", or just seconds.
+     */
+    bool duration(unsigned& n, const std::string& val)
+    {
+	char* end;
+	const unsigned long d = std::strtoul(val.c_str(), &end, 10);
+	if (val.empty() || !std::isdigit(val.front())) return false;
+	const std::string unit {end};
+	unsigned long k;
+	if (unit=="" || unit=="s") k = 1;
+	else if (unit=="m")        k = 60;
+	else if (unit=="h")        k = 3600;
+	else return false;
+	if (d > 1000000 / k) return false;
+	n = d * k;
+	return true;
+    }
+
+    /* A rule like "2G action=restart" or "95% for 60s action=signal:USR1",
+     * for the metric 'name'.
+     */
+    bool watchdog(Command& p, const std::string& name, const std::string& val)
+    {
+	using Watchdog = Command::Watchdog;
+	Watchdog w;
+	const auto v = split(val);
+	if (v.empty()) return false;
+
+	if (name=="rss") {
+	    w.metric = Watchdog::Metric::rss;
+	    if (!size(w.limit, v[0])) return false;
+	}
+	else if (name=="notify") {
+	    w.metric = Watchdog::Metric::notify;
+	    unsigned d;
+	    if (!duration(d, v[0]) || !d) return false;
+	    w.limit = d;
+	}
+	else if (name=="cpu") {
+	    w.metric = Watchdog::Metric::cpu;
+	    std::string s = v[0];
+	    if (s.size() && s.back()=='%') s.pop_back();
+	    char* end;
+	    w.limit = std::strtod(s.c_str(), &end);
+	    if (s.empty() || !std::isdigit(s.front()) || *end || w.limit <= 0) return false;
+	}
+	else return false;
+
+	for (size_t i = 1; i < v.size(); i++) {
+	    const std::string& s = v[i];
+	    if (s=="for" && i+1 < v.size()) {
+		if (!duration(w.duration, v[++i])) return false;
+	    }
+	    else if (s=="action=restart") w.action = Watchdog::Action::restart;
+	    else if (s=="action=stop")    w.action = Watchdog::Action::stop;
+	    else if (s.compare(0, 14, "action=signal:")==0) {
+		w.action = Watchdog::Action::signal;
+		if (!signal(w.signal, s.substr(14))) return false;
+	    }
+	    else return false;
+	}
+
+	p.watchdog.push_back(w);
+	return true;
+    }
+
+    /* Is 'param' a cgroup setting, like memory.max?
+     */
+    bool is_cgroup(const std::string& param)
+    {
+	const auto n = param.find('.');
+	if (n==std::string::npos || n+1==param.size()) return false;
+	const std::string c {param, 0, n};
+	for (const char* s : {"cpu", "cpuset", "memory", "io", "pids",
+			      "hugetlb", "rdma", "misc"}) {
+	    if (c==s) return true;
+	}
+	return false;
+    }
+
+    void cgroup(Command& p, const std::string& param, const std::string& val)
+    {
+	p.cgroup.emplace_back(param, val);
+    }
+
     void env(Command& p, const std::string& name, const std::string& val)
     {
 	p.env.emplace_back(name + '=' + val);
@@ -79,7 +421,78 @@ namespace {
 
     bool invalid(const std::vector<Command>& v)
     {
-	return std::none_of(begin(v), end(v), [] (auto p) { return p.valid(); });
+	return std::none_of(begin(v), end(v), [] (auto& p) { return p.valid(); });
+    }
+
+    /* Check that only programs which notify have watchdog rules on
+     * notifications.
+     */
+    bool notifying(std::ostream& err, const std::vector<Command>& v)
+    {
+	bool ok = true;
+	for (const Command& p : v) {
+	    if (p.notify) continue;
+	    for (const auto& w : p.watchdog) {
+		if (w.metric != Command::Watchdog::Metric::notify) continue;
+		err << "error: " << p.name << " has a notify watchdog, but doesn't notify\n";
+		ok = false;
+		break;
+	    }
+	}
+	return ok;
+    }
+
+    /* Check that the 'after' dependencies are configured programs,
+     * and don't form a cycle. A depth-first search, with the stack
+     * kept by hand since the chains may be long.
+     */
+    bool dependencies(std::ostream& err, const std::vector<Command>& v,
+		      const std::unordered_map<Name, size_t>& index)
+    {
+	bool ok = true;
+	for (const Command& p : v) {
+	    for (const Name& name : p.after) {
+		if (index.count(name)) continue;
+		err << "error: " << p.name << " is to start after "
+		    << name << ", which isn't configured\n";
+		ok = false;
+	    }
+	}
+	if (!ok) return false;
+
+	enum class Color { white, grey, black };
+	std::vector<Color> color(v.size(), Color::white);
+
+	for (size_t root = 0; root < v.size(); root++) {
+	    if (color[root] != Color::white) continue;
+	    color[root] = Color::grey;
+	    std::vector<std::pair<size_t, size_t>> stack {{root, 0}};
+
+	    while (stack.size()) {
+		const size_t n = stack.back().first;
+		const size_t i = stack.back().second++;
+		if (i==v[n].after.size()) {
+		    color[n] = Color::black;
+		    stack.pop_back();
+		    continue;
+		}
+
+		const size_t m = index.at(v[n].after[i]);
+		if (color[m]==Color::white) {
+		    color[m] = Color::grey;
+		    stack.emplace_back(m, 0);
+		}
+		else if (color[m]==Color::grey) {
+		    auto it = std::find_if(begin(stack), end(stack),
+					   [m] (auto& e) { return e.first==m; });
+		    err << "error: dependency cycle: ";
+		    for (; it != end(stack); it++) err << v[it->first].name << " -> ";
+		    err << v[m].name << '\n';
+		    return false;
+		}
+	    }
+	}
+	return true;
     }
 }
 
@@ -96,6 +509,7 @@ Schedule::Schedule(std::ostream& err, const std::string& file)
 	return;
     }
 
+    bool bad = false;
     std::string s;
     while (std::getline(f, s)) {
 	const char* a = s.c_str();
@@ -120,25 +534,119 @@ Schedule::Schedule(std::ostream& err, const std::string& file)
 	    continue;
 	}
 	const std::string name {a, d++};
+	if (name.find('@') != std::string::npos) {
+	    err << "error: '@' in program name in '" << s << "'\n";
+	    bad = true;
+	    continue;
+	}
 	auto e = ws(d, c++);
 	const std::string param {d, e};
 	const auto val = trim(c, b);
 
-	Command& p = command(v, name);
+	Command& p = command(v, index, name);
 
 	if (param=="exec")     exec(p, val);
 	else if (param=="arg") arg(p, val);
 	else if (param=="cwd") cwd(p, val);
+	else if (param=="after") after(p, val);
+	else if (param=="listen") {
+	    Endpoint ep;
+	    if (!endpoint(ep, val)) {
+		err << "error: bad listen address in '" << s << "'\n";
+		bad = true;
+	    }
+	    else p.listen.push_back(ep);
+	}
+	else if (param=="notify") {
+	    if (!yes(p.notify, val)) {
+		err << "error: bad notify setting in '" << s << "'\n";
+		bad = true;
+	    }
+	}
+	else if (param=="restart") {
+	    if (!restart(p, val)) {
+		err << "error: bad restart policy in '" << s << "'\n";
+		bad = true;
+	    }
+	}
+	else if (param=="stop-signal") {
+	    if (!stop_signal(p, val)) {
+		err << "error: bad signal in '" << s << "'\n";
+		bad = true;
+	    }
+	}
+	else if (param=="start-timeout") {
+	    if (!timeout(p.start_timeout, val)) {
+		err << "error: bad timeout in '" << s << "'\n";
+		bad = true;
+	    }
+	}
+	else if (param=="stop-timeout") {
+	    if (!timeout(p.stop_timeout, val)) {
+		err << "error: bad timeout in '" << s << "'\n";
+		bad = true;
+	    }
+	}
+	else if (param=="nice") {
+	    if (!nice(p, val)) {
+		err << "error: bad nice value in '" << s << "'\n";
+		bad = true;
+	    }
+	}
+	else if (param=="sched") {
+	    if (!sched(p, val)) {
+		err << "error: bad scheduling policy in '" << s << "'\n";
+		bad = true;
+	    }
+	}
+	else if (param=="ioprio") {
+	    if (!ioprio(p, val)) {
+		err << "error: bad I/O priority in '" << s << "'\n";
+		bad = true;
+	    }
+	}
+	else if (param=="cpus") {
+	    if (!cpus(p, val)) {
+		err << "error: bad CPU list in '" << s << "'\n";
+		bad = true;
+	    }
+	}
+	else if (param=="instances") {
+	    if (!instances(p, val)) {
+		err << "error: bad number of instances in '" << s << "'\n";
+		bad = true;
+	    }
+	}
+	else if (param=="numa") {
+	    if (!numa(p, val)) {
+		err << "error: bad NUMA node in '" << s << "'\n";
+		bad = true;
+	    }
+	}
+	else if (param.compare(0, 9, "watchdog.")==0) {
+	    if (!watchdog(p, param.substr(9), val)) {
+		err << "error: bad watchdog rule in '" << s << "'\n";
+		bad = true;
+	    }
+	}
+	else if (is_cgroup(param)) cgroup(p, param, val);
 	else                   env(p, param, val);
     }
 
-    fail = v.empty() || invalid(v);
+    fail = bad || v.empty() || invalid(v) || !notifying(err, v)
+	|| !dependencies(err, v, index);
+
+    for (Command& cmd : v) cmd.prepare(environ);
+}
+
+const Command* Schedule::find(const Name& name) const
+{
+    auto it = index.find(name);
+    if (it==index.end()) return nullptr;
+    return &v[it->second];
 }
 
 const Command* find(const Schedule& schedule, const Name& name)
 {
-    for (auto& cmd : schedule) {
-	if (cmd.name==name) return &cmd;
-    }
-    return nullptr;
+    return schedule.find(name);
 }
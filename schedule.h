@@ -5,8 +5,13 @@
 #ifndef DJCL_SCHEDULE_H
 #define DJCL_SCHEDULE_H
 
+#include "placement.h"
+#include "listen.h"
+
 #include <string>
 #include <vector>
+#include <unordered_map>
+#include <utility>
 
 using Name = std::string;
 
@@ -19,8 +24,89 @@ struct Command {
     std::vector<std::string> env;
     std::string cwd {"/"};
 
+    /* Programs which must be ready before this one starts. With
+     * 'notify', ready means it has said so, with sd_notify(3), and
+     * it's stopped if it hasn't within so many seconds (0 for
+     * forever).
+     */
+    std::vector<Name> after;
+    bool notify = false;
+    unsigned start_timeout = 90;
+
+    /* Sockets we listen on, and hand to it.
+     */
+    std::vector<Endpoint> listen;
+
+    enum class Restart { never, on_failure, always };
+    Restart restart = Restart::never;
+
+    /* How to stop it: the signal to send, and how many seconds to
+     * give it before SIGKILL (0 for forever).
+     */
+    int stop_signal;
+    unsigned stop_timeout = 10;
+
+    /* Watchdog rules: a limit on resident memory (bytes), CPU usage
+     * (percent of one CPU) or the seconds since the last WATCHDOG=1
+     * notification; how many seconds it may be exceeded before
+     * anything happens, and what happens then.
+     */
+    struct Watchdog {
+	enum class Metric { rss, cpu, notify };
+	Metric metric;
+	double limit;
+	unsigned duration = 0;
+	enum class Action { restart, stop, signal };
+	Action action = Action::restart;
+	int signal = 0;
+    };
+    std::vector<Watchdog> watchdog;
+
+    /* cgroup v2 settings, like {"memory.max", "1G"}.
+     */
+    std::vector<std::pair<std::string, std::string>> cgroup;
+
+    /* Priorities, or the same as ours if not set: the nice value,
+     * the scheduling policy (like SCHED_FIFO) and its priority, and
+     * the value for ioprio_set(2).
+     */
+    bool renice = false;
+    int nice = 0;
+    int sched = -1;
+    int sched_priority = 0;
+    int ioprio = -1;
+
+    /* CPUs and NUMA node, or "auto" for either: spread out along
+     * with the other programs asking for that.
+     */
+    Placement place;
+    bool auto_cpus = false;
+    bool auto_node = false;
+
+    /* How many instances to run, or "auto" for one per CPU. With
+     * more than one (or "auto"), they're named name@0, name@1 ...
+     */
+    unsigned instances = 1;
+    bool auto_instances = false;
+    bool replicated() const { return instances > 1 || auto_instances; }
+
     explicit Command(const Name&);
+    Command(Command&&) = default;
+    Command(const Command&) = delete;
     bool valid() const;
+    void prepare(char** base);
+
+    /* What exec needs, computed once by prepare() rather than on
+     * every start: the candidate paths for argv[0] (a PATH search
+     * done ahead of time) and the argv/envp arrays. The arrays point
+     * into the Command itself (and into 'base'), hence no copying.
+     * An empty envp means the environment as it is.
+     */
+    struct Image {
+	std::vector<std::string> path;
+	std::vector<char*> argv;
+	std::vector<char*> envp;
+    } image;
 };
 
 /**
@@ -33,9 +119,13 @@ public:
     bool valid() const { return !fail; }
     auto begin() const { return v.begin(); }
     auto end() const { return v.end(); }
+    size_t size() const { return v.size(); }
+
+    const Command* find(const Name& name) const;
 
 private:
     std::vector<Command> v;
+    std::unordered_map<Name, size_t> index;
     bool fail = true;
 };
 
@@ -1,15 +1,12 @@
 #include "server.h"
 
 #include "split.h"
-#include "error.h"
 
 #include <sys/uio.h>
 #include <netdb.h>
 #include <unistd.h>
+#include <errno.h>
 #include <cstring>
-#include <sstream>
-
-struct SocketBlockError : public FatalError {};
 
 namespace {
 
@@ -41,20 +38,11 @@ namespace {
 	return fd;
     }
 
-    /* Write the contents of 'oss', ended with CRLF, to fd. Then empty
-     * the stream so it can be reused. Throw a fatal error if the
-     * write doesn't complete - we have no support for buffering while
-     * sockets are blocked, and so on; it wouldn't be worth it.
+    /* How much unsent output we tolerate for a client before we
+     * stop reading its commands, until it has read some. A single
+     * reply (e.g. a long 'list') may be larger than this.
      */
-    void drain(int fd, std::ostringstream& oss)
-    {
-	oss << crlf;
-	auto s = oss.str();
-	oss.str("");
-	ssize_t n = write(fd, s.data(), s.size());
-	size_t len = n;
-	if (n==-1 || len != s.size()) throw SocketBlockError {};
-    }
+    constexpr size_t backlog = 1 << 20;
 }
 
 Server::Server(Syslog& log, Spider& spider, Parent& parent)
@@ -64,26 +52,41 @@ Server::Server(Syslog& log, Spider& spider, Parent& parent)
 {}
 
 /**
- * A listening socket is readable; let a client connect.
+ * A listening socket is readable; let a client (or, if the Spider is
+ * edge-triggered, all pending clients) connect.
  */
 void Server::connect(int lfd)
+{
+    const bool drain = spider.edge_triggered();
+    bool more;
+    do {
+	more = connect1(lfd);
+    } while (drain && more);
+}
+
+bool Server::connect1(int lfd)
 {
     sockaddr_storage sa;
     int fd = accept(lfd, sa);
+    if (fd==-1) return false;
     Info{log} << "new connection from " << sa;
 
-    std::ostringstream greeting;
-    greeting << "ok Hello. This is djcl; please type commands.";
-    drain(fd, greeting);
-
     ss.erase(fd);
-    ss.emplace(fd, Client{sa});
+    auto it = ss.emplace(fd, Client{sa, fd, ++serial}).first;
 
     spider.read(fd, [&] (int fd) { read(fd); });
+
+    std::ostringstream greeting;
+    greeting << "ok Hello. This is djcl; please type commands.";
+    send(it->second, greeting);
+    flush(fd);
+    return true;
 }
 
-Server::Client::Client(const sockaddr_storage& sa)
+Server::Client::Client(const sockaddr_storage& sa, int fd, unsigned long serial)
     : sa {sa},
+      fd {fd},
+      serial {serial},
       text {crlf}
 {}
 
@@ -93,41 +96,150 @@ Server::Client::Client(const sockaddr_storage& sa)
  */
 void Server::read(int fd)
 {
-    bool close = false;
-    std::ostringstream resp;
-
     const auto it = ss.find(fd);
     if (it==end(ss)) return;
     Client& client = it->second;
 
-    client.text.feed(fd);
+    const bool drain = spider.edge_triggered();
+    bool more;
+    do {
+	more = client.text.feed(fd);
+	run(client);
+    } while (drain && more && !client.text.eof());
+
+    if (client.text.eof() && !client.waiting) {
+	/* Half-closed, maybe; the replies are still wanted, and the
+	 * connection closes once they're written.
+	 */
+	Info{log} << "" << client.sa << ": connection closed by peer";
+	client.closing = true;
+    }
 
+    throttle(client);
+    flush(fd);
+}
+
+/**
+ * Execute the commands the client has sent, until it has to wait for
+ * a reply.
+ */
+void Server::run(Client& client)
+{
+    std::ostringstream resp;
     char* a; char* b;
-    while (client.text.read(a, b)) {
+    while (!client.closing && !client.waiting && client.text.read(a, b)) {
 	std::string s {a, b};
-	if (!exec(resp, s)) close = true;
-	drain(fd, resp);
+	if (!exec(client, resp, s)) client.closing = true;
+	if (!client.waiting) send(client, resp);
     }
+}
+
+/**
+ * A deferred reply to a client, if it's still around. Then, since it
+ * may have sent more commands meanwhile, continue with those.
+ */
+void Server::reply(int fd, unsigned long serial, const std::string& s)
+{
+    const auto it = ss.find(fd);
+    if (it==end(ss) || it->second.serial != serial) return;
+    Client& client = it->second;
+
+    std::ostringstream resp;
+    resp << s;
+    send(client, resp);
+    client.waiting = false;
+    run(client);
 
-    if (client.text.eof()) {
+    if (client.text.eof() && !client.waiting) {
 	Info{log} << "" << client.sa << ": connection closed by peer";
-	ss.erase(it);
-	::close(fd);
+	client.closing = true;
     }
-    else if (close) {
+
+    flush(fd);
+}
+
+/**
+ * Queue the contents of 'oss', ended with CRLF, for the client. Then
+ * empty the stream so it can be reused.
+ */
+void Server::send(Client& client, std::ostringstream& oss)
+{
+    oss << crlf;
+    client.out += oss.str();
+    oss.str("");
+}
+
+/**
+ * Write as much as possible of the client's pending output. If the
+ * socket won't take all of it, continue when it becomes writable
+ * again. A client which asked to be disconnected is, once everything
+ * has been written.
+ */
+void Server::flush(int fd)
+{
+    const auto it = ss.find(fd);
+    if (it==end(ss)) return;
+    Client& client = it->second;
+
+    while (client.pending()) {
+	const ssize_t n = ::write(fd, client.out.data() + client.sent,
+				  client.pending());
+	if (n==-1) {
+	    if (errno==EINTR) continue;
+	    if (errno==EAGAIN) break;
+	    Info{log} << "" << client.sa << ": " << std::strerror(errno);
+	    close(it);
+	    return;
+	}
+	client.sent += n;
+    }
+
+    throttle(client);
+    if (client.pending()) {
+	spider.write(fd, [&] (int fd) { flush(fd); });
+	return;
+    }
+
+    client.out.clear();
+    client.sent = 0;
+
+    if (client.closing) {
 	Info{log} << "" << client.sa << ": closing connection";
-	ss.erase(it);
-	::close(fd);
+	close(it);
     }
 }
 
+/**
+ * Read from the client only while it makes sense: not after EOF, not
+ * while it waits for a deferred reply (its commands would just pile
+ * up), and not while it has a lot of output waiting, since then it's
+ * not reading our replies and more commands would only make more.
+ */
+void Server::throttle(Client& client)
+{
+    const bool pause = client.text.eof() || client.waiting
+		       || client.pending() > backlog;
+    if (pause==client.paused) return;
+    client.paused = pause;
+    if (pause) spider.pause(client.fd);
+    else spider.resume(client.fd);
+}
+
+void Server::close(std::map<int, Client>::iterator it)
+{
+    const int fd = it->first;
+    ss.erase(it);
+    spider.forget(fd);
+    ::close(fd);
+}
+
 /**
  * Execute a single textual command, which is a line of text.
  *
  * Writes a textual response to 'os', but doesn't line-terminate it.
  * Returns false if the connection should close.
  */
-bool Server::exec(std::ostream& os, const std::string& s)
+bool Server::exec(Client& client, std::ostream& os, const std::string& s)
 {
     const auto v = split(s, 2);
     if (v.empty()) {
@@ -147,12 +259,12 @@ bool Server::exec(std::ostream& os, const std::string& s)
     }
 
     if (cmd=="stop") {
-	if (v.size() > 1) {
-	    parent.stop(os, v[1]);
-	}
-	else {
-	    parent.stop_all(os);
-	}
+	client.waiting = stop(client, os, v.size() > 1 ? v[1] : "");
+	return true;
+    }
+
+    if (cmd=="replace" && v.size() > 1) {
+	parent.replace(os, v[1]);
 	return true;
     }
 
@@ -162,6 +274,18 @@ bool Server::exec(std::ostream& os, const std::string& s)
 	return true;
     }
 
+    if (cmd=="stats") {
+	if (v.size() > 1) {
+	    if (!parent.usage(os, v[1])) return true;
+	}
+	else {
+	    stats(os);
+	    parent.usage(os);
+	}
+	os << "ok";
+	return true;
+    }
+
     if (cmd=="die") {
 	spider.stop();
 	os << "ok djcl exiting";
@@ -177,10 +301,52 @@ bool Server::exec(std::ostream& os, const std::string& s)
 
     os << rc << " usage:\n"
 		"   start [name]\n"
-		"   stop  [name]\n"
+		"   stop  [--wait] [name]\n"
+		"   replace name\n"
 		"   list\n"
+		"   stats [name]\n"
 		"   help\n"
 		"   die\n"
 		"   exit";
     return true;
 }
+
+/**
+ * The stop command, with its arguments [--wait] [name]. Returns true
+ * if the reply is deferred until the program(s) have exited.
+ */
+bool Server::stop(Client& client, std::ostream& os, const std::string& args)
+{
+    std::string name = args;
+    Parent::Waiter w;
+
+    const auto v = split(args, 2);
+    if (v.size() && v[0]=="--wait") {
+	name = v.size() > 1 ? v[1] : "";
+	w = [this, fd = client.fd, serial = client.serial] (const std::string& s) {
+	    reply(fd, serial, s);
+	};
+    }
+
+    if (name.size()) return parent.stop(os, name, w);
+    return parent.stop_all(os, w);
+}
+
+/**
+ * Counters which say something about how efficiently we're doing
+ * I/O: waits for events (epoll_wait(2) or io_uring_enter(2)), the
+ * events they returned, epoll_ctl(2) calls or io_uring submissions,
+ * reads of programs' output and the lines of text they yielded.
+ */
+void Server::stats(std::ostream& os) const
+{
+    const auto sp = spider.stats();
+    const auto& pp = parent.stats();
+
+    os << "backend " << spider.backend() << "\r\n"
+       << "waits   " << sp.waits << "\r\n"
+       << "events  " << sp.events << "\r\n"
+       << "ctls    " << sp.ctls << "\r\n"
+       << "reads   " << sp.reads << "\r\n"
+       << "lines   " << pp.lines << "\r\n";
+}
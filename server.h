@@ -12,6 +12,7 @@
 
 #include <map>
 #include <functional>
+#include <sstream>
 
 #include <sys/socket.h>
 
@@ -25,23 +26,49 @@ public:
 
     void connect(int lfd);
     void read(int fd);
+    void flush(int fd);
 
 private:
     Syslog& log;
     Spider& spider;
     Parent& parent;
 
-    bool exec(std::ostream& os, const std::string& s);
-
+    /* A connected client, and whatever we have written to it which
+     * the socket hasn't accepted yet; out[sent..] is pending. While
+     * it's waiting for a deferred reply, its further commands wait
+     * too. The serial number tells it from a later client on the
+     * same fd. It's paused while we don't read from it.
+     */
     struct Client {
-	explicit Client(const sockaddr_storage& sa);
+	Client(const sockaddr_storage& sa, int fd, unsigned long serial);
 	Client(Client&&) = default;
 
 	const sockaddr_storage sa;
+	const int fd;
+	const unsigned long serial;
 	sockutil::TextReader text;
+	std::string out;
+	size_t sent = 0;
+	bool closing = false;
+	bool waiting = false;
+	bool paused = false;
+
+	size_t pending() const { return out.size() - sent; }
     };
 
     std::map<int, Client> ss;
+    unsigned long serial = 0;
+
+    bool connect1(int lfd);
+    void run(Client& client);
+    bool exec(Client& client, std::ostream& os, const std::string& s);
+    bool stop(Client& client, std::ostream& os, const std::string& args);
+    void reply(int fd, unsigned long serial, const std::string& s);
+    void stats(std::ostream& os) const;
+
+    void send(Client& client, std::ostringstream& oss);
+    void throttle(Client& client);
+    void close(std::map<int, Client>::iterator it);
 };
 
 #endif
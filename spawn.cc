@@ -0,0 +1,252 @@
+/* Copyright (c) 2024 Jrgen Grahn
+ * All rights reserved.
+ *
+ */
+#include "spawn.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <sched.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+#include <linux/ioprio.h>
+#include <climits>
+
+namespace {
+
+    struct Child {
+	const Command& cmd;
+	const Placement& where;
+	char* const* envp;
+	const std::vector<int>& listen;
+	int cgroup;
+	Pipe& stdout;
+	Pipe& stderr;
+	sigset_t mask;
+    };
+
+    /* The stack the child runs on until it execs. We're suspended
+     * meanwhile, so one is enough.
+     */
+    alignas(16) char stack[64 * 1024];
+
+    /* Set by the child if it fails before exec. Since we share
+     * memory until then, we see it once clone() returns.
+     */
+    bool failed;
+
+    /* Write "error: name: what[arg]: why" on stderr, without
+     * allocating, and exit.
+     */
+    [[noreturn]] void fail(const Command& cmd, int err,
+			   const char* what, const char* arg = "")
+    {
+	const char* why = std::strerror(err);
+	auto iov = [] (const char* s) {
+	    return iovec {const_cast<char*>(s), std::strlen(s)};
+	};
+	const iovec v[] = {
+	    iov("error: "), iov(cmd.name.c_str()), iov(": "),
+	    iov(what), iov(arg), iov(": "), iov(why), iov("\n")
+	};
+	(void)writev(2, v, sizeof v / sizeof *v);
+	failed = true;
+	_exit(1);
+    }
+
+    /* From <numaif.h>, which is in libnuma rather than glibc.
+     */
+    constexpr int mpol_bind = 2;
+
+    int set_mempolicy(int mode, const unsigned long* mask, unsigned long maxnode)
+    {
+	return syscall(SYS_set_mempolicy, mode, mask, maxnode);
+    }
+
+    /* Pin the child to its CPUs, and bind its memory to its NUMA
+     * node. Both outlive exec.
+     */
+    void place(const Command& cmd, const Placement& where)
+    {
+	if (where.cpus.size()) {
+	    cpu_set_t set;
+	    CPU_ZERO(&set);
+	    for (unsigned cpu : where.cpus) CPU_SET(cpu, &set);
+	    if (sched_setaffinity(0, sizeof set, &set)) {
+		fail(cmd, errno, "cannot set CPU affinity");
+	    }
+	}
+
+	if (where.node != -1) {
+	    constexpr unsigned bits = sizeof(unsigned long) * CHAR_BIT;
+	    unsigned long mask[max_nodes / bits] = {};
+	    mask[where.node / bits] |= 1ul << where.node % bits;
+	    /* The kernel ignores the last of 'maxnode' bits. */
+	    if (set_mempolicy(mpol_bind, mask, max_nodes + 1)) {
+		fail(cmd, errno, "cannot bind memory to NUMA node");
+	    }
+	}
+    }
+
+    /* Make the listening sockets fds 3 and up, without close-on-exec.
+     * They go via fds above all of them first, so that none is
+     * overwritten before it has been moved.
+     */
+    void pass(const Command& cmd, const std::vector<int>& fds)
+    {
+	int base = 3 + fds.size();
+	for (int fd : fds) base = std::max(base, fd + 1);
+
+	for (unsigned i = 0; i < fds.size(); i++) {
+	    if (dup3(fds[i], base + i, O_CLOEXEC)==-1) {
+		fail(cmd, errno, "cannot pass listening socket");
+	    }
+	}
+	for (unsigned i = 0; i < fds.size(); i++) {
+	    if (dup2(base + i, 3 + i)==-1) {
+		fail(cmd, errno, "cannot pass listening socket");
+	    }
+	}
+    }
+
+    /* Write our pid after "LISTEN_PID=" in the environment, in the
+     * room left there for it.
+     */
+    void listen_pid(char* const* envp)
+    {
+	for (; envp && *envp; envp++) {
+	    if (std::strncmp(*envp, "LISTEN_PID=", 11)) continue;
+	    char buf[10];
+	    char* p = buf + sizeof buf;
+	    unsigned pid = getpid();
+	    do {
+		*--p = '0' + pid % 10;
+		pid /= 10;
+	    } while (pid && p != buf);
+	    char* dst = *envp + 11;
+	    while (p != buf + sizeof buf) *dst++ = *p++;
+	    *dst = '\0';
+	    return;
+	}
+    }
+
+    int ioprio_set(int ioprio)
+    {
+	return syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, ioprio);
+    }
+
+    /* Set the child's priorities, which also outlive exec.
+     */
+    void prioritize(const Command& cmd)
+    {
+	if (cmd.renice && setpriority(PRIO_PROCESS, 0, cmd.nice)) {
+	    fail(cmd, errno, "cannot set nice value");
+	}
+
+	if (cmd.sched != -1) {
+	    sched_param param {};
+	    param.sched_priority = cmd.sched_priority;
+	    if (sched_setscheduler(0, cmd.sched, &param)) {
+		fail(cmd, errno, "cannot set scheduling policy");
+	    }
+	}
+
+	if (cmd.ioprio != -1 && ioprio_set(cmd.ioprio)) {
+	    fail(cmd, errno, "cannot set I/O priority");
+	}
+    }
+
+    /* In the child process, sharing our memory; it mustn't do
+     * anything which touches it in ways that matter. Sets up its
+     * process group, stdout/stderr, its cgroup, placement, priorities, listening
+     * sockets and $CWD, and
+     * then tries exec on the candidate paths in order. Like execvp(3), it
+     * keeps going past anything that isn't there, and remembers
+     * anything else which went wrong.
+     */
+    int child(void* arg)
+    {
+	Child& c = *static_cast<Child*>(arg);
+	const Command& cmd = c.cmd;
+	const auto& image = cmd.image;
+
+	if (setpgid(0, 0)) {
+	    fail(cmd, errno, "cannot create process group");
+	}
+
+	c.stdout.child(1);
+	c.stderr.child(2);
+
+	if (c.cgroup != -1 && write(c.cgroup, "0", 1) != 1) {
+	    fail(cmd, errno, "cannot join cgroup");
+	}
+
+	place(cmd, c.where);
+	prioritize(cmd);
+
+	if (c.listen.size()) {
+	    pass(cmd, c.listen);
+	    listen_pid(c.envp);
+	}
+
+	if (cmd.cwd.size() && chdir(cmd.cwd.c_str())) {
+	    fail(cmd, errno, "cannot chdir to ", cmd.cwd.c_str());
+	}
+
+	sigset_t mask = c.mask;
+	sigdelset(&mask, SIGCHLD);
+	sigprocmask(SIG_SETMASK, &mask, nullptr);
+
+	char* const* argv = image.argv.data();
+	char* const* envp = c.envp;
+	if (!envp) envp = image.envp.size() ? image.envp.data() : environ;
+
+	int err = ENOENT;
+	for (const std::string& path : image.path) {
+	    execve(path.c_str(), argv, envp);
+	    if (errno != ENOENT && errno != ENOTDIR) err = errno;
+	}
+	fail(cmd, err, "exec failed");
+    }
+}
+
+Pid spawn(const Command& cmd, const Placement& where,
+	  char* const* envp, const std::vector<int>& listen, int cgroup,
+	  Pipe& stdout, Pipe& stderr, int& pidfd, bool& execd)
+{
+    if (!cmd.valid()) {
+	errno = EINVAL;
+	return {};
+    }
+
+    /* Keep signals away from the child until it has exec'd, so no
+     * handler of ours runs there.
+     */
+    Child c {cmd, where, envp, listen, cgroup, stdout, stderr, {}};
+    sigset_t all;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &c.mask);
+
+    failed = false;
+    const int pid = clone(child, stack + sizeof stack,
+			  CLONE_VM | CLONE_VFORK | CLONE_PIDFD | SIGCHLD,
+			  &c, &pidfd);
+    const int err = errno;
+
+    pthread_sigmask(SIG_SETMASK, &c.mask, nullptr);
+
+    if (pid==-1) {
+	errno = err;
+	return {};
+    }
+
+    stdout.parent();
+    stderr.parent();
+    execd = !failed;
+    return pid;
+}
@@ -0,0 +1,39 @@
+/* Copyright (c) 2024 Jrgen Grahn
+ * All rights reserved.
+ *
+ */
+#ifndef DJCL_SPAWN_H
+#define DJCL_SPAWN_H
+
+#include "schedule.h"
+#include "placement.h"
+#include "pipes.h"
+#include "pid.h"
+
+/**
+ * Start a prepared Command, with stdout and stderr going to the
+ * pipes, and return its pid and (through 'pidfd') a pidfd for it.
+ * Returns a null Pid and sets errno on failure. The child leads a new
+ * process group, and has our signal mask except for SIGCHLD, which
+ * we may be blocking for a signalfd(2). If 'cgroup' isn't -1,
+ * it's a cgroup.procs file which the child moves itself into before
+ * exec. It also puts itself on the CPUs and NUMA node in 'where'
+ * (rather than those in the Command, which may say "auto"), and uses
+ * 'envp' as its environment unless it's null.
+ *
+ * The 'listen' fds become the child's fds 3 and up. Then there should
+ * be a "LISTEN_PID=" entry in 'envp', with room for ten digits after
+ * the '=', and the child writes its pid there.
+ *
+ * The child borrows our memory and stack until it has exec'd, like
+ * with vfork(2), so the cost doesn't grow with our own size like it
+ * does with fork(2). What still grows with us is the fd table, which
+ * the child gets a copy of. Failing to chdir or exec is reported on the
+ * child's stderr, and it exits with status 1. Such a child still has
+ * to be reaped, so it still has a pid, but 'execd' is false.
+ */
+Pid spawn(const Command& cmd, const Placement& where,
+	  char* const* envp, const std::vector<int>& listen, int cgroup,
+	  Pipe& stdout, Pipe& stderr, int& pidfd, bool& execd);
+
+#endif
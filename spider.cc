@@ -1,57 +1,436 @@
 #include "spider.h"
 
-#include <array>
+#include "uring.h"
+#include "error.h"
+#include "log.h"
+
+#include <cstring>
+
 #include <sys/epoll.h>
 #include <unistd.h>
+#include <poll.h>
 #include <errno.h>
 
-Spider::Spider()
-    : epfd(epoll_create1(EPOLL_CLOEXEC))
-{}
+namespace {
+
+    using Clock = TimerWheel::Clock;
+
+    /* Timer resolution, and the number of wheel slots. One lap
+     * around the wheel is 40 s; longer timers are fine, but cost a
+     * wakeup per lap.
+     */
+    constexpr TimerWheel::Duration tick {10};
+    constexpr unsigned slots = 4096;
+
+    /* The number of events fetched per epoll_wait(); it starts small
+     * and doubles whenever it has been filled, up to a limit.
+     */
+    constexpr size_t min_batch = 16;
+    constexpr size_t max_batch = 4096;
+
+    /* Reading streams: the buffer for epoll, and the provided
+     * buffers and queue size for io_uring.
+     */
+    constexpr size_t bufsize = 64 * 1024;
+    constexpr unsigned nbuf = 64;
+    constexpr unsigned entries = 256;
+
+    /* What an io_uring request is for.
+     */
+    enum Kind : unsigned { readable = 1, writable = 2, data = 3 };
+
+    /* Waiting for events failed for real, and the loop can't go on.
+     */
+    void fatal(const char* what)
+    {
+	Err{Syslog::log} << what << ": " << std::strerror(errno);
+	throw FatalError {};
+    }
+}
+
+/**
+ * Use io_uring if asked to, and if it's available; epoll otherwise.
+ * The caller can check backend() to see what it got.
+ */
+Spider::Spider(bool edge, bool use_uring)
+    : epfd(epoll_create1(EPOLL_CLOEXEC)),
+      edge {edge},
+      ev(min_batch),
+      buf(bufsize),
+      timers {Clock::now(), tick, slots}
+{
+    if (use_uring) {
+	uring = std::make_unique<Uring>(entries, nbuf, 16 * 1024);
+	if (!uring->valid()) uring.reset();
+    }
+}
+
+Spider::~Spider()
+{
+    close(epfd);
+}
+
+Spider::Entry& Spider::entry(int fd)
+{
+    while (ff.size() <= unsigned(fd)) {
+	ff.push_back({int(ff.size()), 0, {}, {}, {}, false});
+    }
+    return ff[fd];
+}
+
+/* The entry for 'fd', with any earlier registrations forgotten.
+ */
+Spider::Entry& Spider::reset(int fd)
+{
+    forget(fd);
+    return entry(fd);
+}
+
+std::uint64_t Spider::tag(const Entry& e, unsigned kind) const
+{
+    return std::uint64_t(e.gen) << 32 | std::uint64_t(e.fd) << 2 | kind;
+}
 
 /* During loop(), monitor 'fd' for readability and call f(fd).
  *
- * There's no support for unregistering events. An fd gets removed
- * from the epoll set by the kernel when closed, and probably reused
- * soon after (at which point its Spider::ff map entry gets reused,
- * too).
+ * There's no support for unregistering events, except forget().
+ * With epoll, an fd gets removed from the epoll set by the kernel
+ * when closed, and probably reused soon after (at which point its
+ * Spider::ff entry gets reused, too).
  */
-void Spider::read(int fd, std::function<void(int)> f)
+void Spider::read(int fd, Handler f)
 {
-    ff[fd] = f;
+    Entry& e = reset(fd);
+    e.rf = f;
 
-    epoll_event ev {};
-    ev.events = EPOLLIN;
-    ev.data.fd = fd;
-    epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+    if (uring) {
+	uring->poll(fd, POLLIN, true, tag(e, readable));
+    }
+    else {
+	ctl(EPOLL_CTL_ADD, e, EPOLLIN);
+    }
+}
+
+/* During loop(), call f(fd) once, when 'fd' (which must already be
+ * monitored for readability, or paused) becomes writable. After that
+ * the fd is only monitored as before, unless write() is called anew.
+ */
+void Spider::write(int fd, Handler f)
+{
+    if (ff.size() <= unsigned(fd)) return;
+    Entry& e = ff[fd];
+    const bool armed = bool(e.wf);
+    e.wf = f;
+    if (armed) return;
+
+    if (uring) {
+	uring->poll(fd, POLLOUT, false, tag(e, writable));
+    }
+    else if (e.reading()) {
+	ctl(EPOLL_CTL_MOD, e, EPOLLIN | EPOLLOUT);
+    }
+    else {
+	/* Paused, and so not in the epoll set.
+	 */
+	ctl(EPOLL_CTL_ADD, e, EPOLLOUT);
+    }
+}
+
+/* During loop(), read whatever arrives on 'fd', and call f(fd, p, n)
+ * with it, or f(fd, nullptr, 0) on EOF or error. After that, forget
+ * and close the fd.
+ */
+void Spider::stream(int fd, Sink f)
+{
+    Entry& e = reset(fd);
+    e.sf = f;
+
+    if (uring) {
+	uring->read(fd, tag(e, data));
+    }
+    else {
+	ctl(EPOLL_CTL_ADD, e, EPOLLIN);
+    }
+}
+
+/* Stop monitoring 'fd'; to be called before closing it.
+ */
+void Spider::forget(int fd)
+{
+    if (ff.size() <= unsigned(fd)) return;
+    Entry& e = ff[fd];
+
+    if (uring) {
+	if (e.rf) uring->cancel(tag(e, readable));
+	if (e.wf) uring->cancel(tag(e, writable));
+	if (e.sf) uring->cancel(tag(e, data));
+    }
+    else if (e.paused && e.wf) {
+	/* Still in the epoll set, which read() wouldn't expect.
+	 */
+	ctl(EPOLL_CTL_DEL, e, 0);
+    }
+
+    e.rf = {};
+    e.wf = {};
+    e.sf = {};
+    e.paused = false;
+    e.gen++;
+}
+
+/* Stop reading 'fd' for now, e.g. when it's at EOF but we have more
+ * to write, or when we don't want more input yet. write() works as
+ * usual meanwhile, and resume() takes up reading again, with the
+ * same handler.
+ */
+void Spider::pause(int fd)
+{
+    if (ff.size() <= unsigned(fd)) return;
+    Entry& e = ff[fd];
+    if (!e.reading()) return;
+    e.paused = true;
+
+    if (uring) {
+	if (e.rf) uring->cancel(tag(e, readable));
+	if (e.sf) uring->cancel(tag(e, data));
+    }
+    else if (e.wf) {
+	ctl(EPOLL_CTL_MOD, e, EPOLLOUT);
+    }
+    else {
+	ctl(EPOLL_CTL_DEL, e, 0);
+    }
+}
+
+void Spider::resume(int fd)
+{
+    if (ff.size() <= unsigned(fd)) return;
+    Entry& e = ff[fd];
+    if (!e.paused) return;
+    e.paused = false;
+
+    if (uring) {
+	if (e.rf) uring->poll(fd, POLLIN, true, tag(e, readable));
+	if (e.sf) uring->read(fd, tag(e, data));
+    }
+    else if (e.wf) {
+	ctl(EPOLL_CTL_MOD, e, EPOLLIN | EPOLLOUT);
+    }
+    else {
+	ctl(EPOLL_CTL_ADD, e, EPOLLIN);
+    }
+}
+
+/* Call f() each time the loop is about to wait for events, i.e. when
+ * this round's work is done.
+ */
+void Spider::idle(std::function<void()> f)
+{
+    idlef = f;
+}
+
+/* During loop(), call f() once, when 'd' has passed. The timer can
+ * be cancelled until then.
+ */
+Spider::Timer Spider::after(Duration d, std::function<void()> f)
+{
+    return timers.add(Clock::now() + d, f);
+}
+
+/* Cancel a timer, and reset the handle. It's fine to cancel one
+ * which has already fired, or an empty one.
+ */
+void Spider::cancel(Timer& timer)
+{
+    timers.cancel(timer);
 }
 
 /* Stop the event loop (after this round).
  */
 void Spider::stop()
 {
-    // No need for an extra flag, when closing the epoll fd is a very
-    // explicit and final action.
-    close(epfd);
+    stopped = true;
+}
+
+Spider::Stats Spider::stats() const
+{
+    Stats s = st;
+    if (uring) s.ctls = uring->submitted();
+    return s;
 }
 
 /* The event loop. Runs forever, or until after stop() has been
- * called.
+ * called. Throws FatalError if it can't wait for events.
  */
 void Spider::loop()
 {
-    while (1) {
-	std::array<epoll_event, 5> ev;
-	const int n = epoll_wait(epfd, ev.data(), ev.size(), -1);
+    if (uring) {
+	loop_uring();
+    }
+    else {
+	loop_epoll();
+    }
+}
+
+void Spider::loop_epoll()
+{
+    while (!stopped) {
+	if (idlef) idlef();
+
+	const int n = epoll_wait(epfd, ev.data(), ev.size(), timeout());
+	st.waits++;
 	if (n==-1) {
 	    if (errno==EINTR) continue;
-	    break;
+	    fatal("epoll_wait");
 	}
+	st.events += n;
+
+	timers.advance(Clock::now());
 
 	for (int i=0; i < n; i++) {
-	    const int fd = ev[i].data.fd;
-	    auto it = ff.find(fd);
-	    if (it != end(ff)) it->second(fd);
+	    Entry& e = *static_cast<Entry*>(ev[i].data.ptr);
+	    const int fd = e.fd;
+
+	    if (ev[i].events & EPOLLOUT && e.wf) {
+		const Handler f = e.wf;
+		e.wf = {};
+		if (e.reading()) ctl(EPOLL_CTL_MOD, e, EPOLLIN);
+		else ctl(EPOLL_CTL_DEL, e, 0);
+		f(fd);
+	    }
+
+	    if (ev[i].events & ~EPOLLOUT && !e.paused) {
+		if (e.rf) e.rf(fd);
+		else if (e.sf) input(e);
+	    }
+	}
+
+	if (unsigned(n) == ev.size() && ev.size() < max_batch) {
+	    ev.resize(2 * ev.size());
+	}
+    }
+}
+
+void Spider::ctl(int op, Entry& e, unsigned events)
+{
+    epoll_event ev {};
+    ev.events = events;
+    if (edge) ev.events |= EPOLLET;
+    ev.data.ptr = &e;
+    epoll_ctl(epfd, op, e.fd, &ev);
+    st.ctls++;
+}
+
+/* A stream is readable (epoll). Read once, or until EAGAIN if we're
+ * edge-triggered.
+ */
+void Spider::input(Entry& e)
+{
+    const int fd = e.fd;
+
+    while (e.sf) {
+	const ssize_t n = ::read(fd, buf.data(), buf.size());
+	st.reads++;
+	if (n==-1 && errno==EINTR) continue;
+	if (n==-1 && errno==EAGAIN) break;
+
+	const Sink f = e.sf;
+	const size_t len = n==-1 ? 0 : n;
+	f(fd, buf.data(), len);
+	if (!len || !edge) break;
+    }
+}
+
+void Spider::loop_uring()
+{
+    while (!stopped) {
+	if (idlef) idlef();
+
+	const int n = uring->wait(timeout());
+	st.waits++;
+	/* EBUSY and EAGAIN mean the completions must be reaped before
+	 * more can be submitted, which happens below anyway.
+	 */
+	if (n==-1 && errno!=ETIME && errno!=EINTR
+	    && errno!=EBUSY && errno!=EAGAIN) fatal("io_uring_enter");
+
+	timers.advance(Clock::now());
+
+	st.events += uring->reap([&] (const io_uring_cqe& cqe) {
+				     complete(cqe);
+				 });
+    }
+}
+
+/* An io_uring completion: a poll result, or data on a stream. The
+ * multishot requests need rearming when they end for harmless
+ * reasons, like the provided buffers running out.
+ */
+void Spider::complete(const io_uring_cqe& cqe)
+{
+    const std::uint64_t t = cqe.user_data;
+    const unsigned kind = t & 3;
+    const unsigned fd = (t >> 2) & 0x3fffffff;
+    const unsigned gen = t >> 32;
+    const bool more = cqe.flags & IORING_CQE_F_MORE;
+    const bool buffer = cqe.flags & IORING_CQE_F_BUFFER;
+    const unsigned bid = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+    const int res = cqe.res;
+
+    auto current = [&] { return fd < ff.size() && ff[fd].gen == gen; };
+
+    if (!kind || !current()) {
+	if (buffer) uring->recycle(bid);
+	return;
+    }
+
+    Entry& e = ff[fd];
+
+    switch (kind) {
+    case readable:
+	if (res < 0 || e.paused) break;
+	if (!more) uring->poll(fd, POLLIN, true, t);
+	if (e.rf) e.rf(fd);
+	break;
+
+    case writable:
+	if (res < 0 || !e.wf) break;
+	{
+	    const Handler f = e.wf;
+	    e.wf = {};
+	    f(fd);
 	}
+	break;
+
+    case data:
+	st.reads++;
+	if (buffer) {
+	    if (res > 0) {
+		const Sink f = e.sf;
+		f(fd, uring->buffer(bid), res);
+	    }
+	    uring->recycle(bid);
+	}
+	if (more || !current() || !e.sf || e.paused) break;
+
+	if (res > 0 || res==-ENOBUFS) {
+	    uring->read(fd, t);
+	}
+	else if (res != -ECANCELED) {
+	    const Sink f = e.sf;
+	    f(fd, nullptr, 0);
+	}
+	break;
     }
 }
+
+/* The wait timeout in milliseconds, i.e. until the timer wheel
+ * needs attention, or -1 if there are no timers.
+ */
+int Spider::timeout() const
+{
+    if (timers.empty()) return -1;
+    const auto d = timers.next() - Clock::now();
+    const auto ms = std::chrono::ceil<Duration>(d).count();
+    return ms < 0 ? 0 : ms;
+}
@@ -5,14 +5,40 @@
 #ifndef DJCL_SPIDER_H
 #define DJCL_SPIDER_H
 
+#include "timerwheel.h"
+#include "callback.h"
+
 #include <functional>
-#include <map>
+#include <memory>
+#include <deque>
+#include <vector>
+#include <cstdint>
+
+#include <sys/epoll.h>
+
+class Uring;
+struct io_uring_cqe;
 
 /**
- * A specialized wrapper around epoll(7). The name is mostly an inside
- * joke.
+ * A specialized wrapper around epoll(7), or optionally io_uring(7).
+ * The name is mostly an inside joke.
+ *
+ * Supports acting on sockets being readable, and (one-shot) on them
+ * being writable. Also timers, so that things can be scheduled
+ * without anyone inventing their own clock.
  *
- * Only supports acting on sockets being readable.
+ * Streams (pipes from child processes, really) are special: Spider
+ * does the reading, and hands over the data. That's what lets the
+ * io_uring backend use multishot reads, with no system calls per
+ * chunk of data. An empty chunk means EOF.
+ *
+ * Optionally edge-triggered, in which case the handlers must keep
+ * reading until EAGAIN; they can check edge_triggered() to find out.
+ * The io_uring backend is always edge-triggered, in that sense.
+ *
+ * Before an fd is closed, it should be forget()ed. With epoll that
+ * doesn't matter much, but io_uring holds on to the file until its
+ * requests are cancelled.
  *
  * The design might not be generally useful. There seems to be no
  * consensus on how to do this kind of thing, and I haven't been
@@ -20,17 +46,83 @@
  */
 class Spider {
 public:
-    Spider();
+    explicit Spider(bool edge = false, bool uring = false);
+    ~Spider();
     Spider(const Spider&) = delete;
 
-    void read(int fd, std::function<void(int)> f);
+    using Handler = Callback<void(int)>;
+    using Sink = Callback<void(int, const char*, size_t)>;
+
+    void read(int fd, Handler f);
+    void write(int fd, Handler f);
+    void stream(int fd, Sink f);
+    void forget(int fd);
+    void pause(int fd);
+    void resume(int fd);
+    void idle(std::function<void()> f);
     void stop();
 
+    using Timer = TimerWheel::Timer;
+    using Duration = TimerWheel::Duration;
+    Timer after(Duration d, std::function<void()> f);
+    void cancel(Timer& timer);
+
     void loop();
 
+    bool edge_triggered() const { return edge || uring; }
+    const char* backend() const { return uring ? "io_uring" : "epoll"; }
+
+    struct Stats {
+	unsigned long waits = 0;
+	unsigned long events = 0;
+	unsigned long ctls = 0;
+	unsigned long reads = 0;
+    };
+    Stats stats() const;
+
 private:
     const int epfd;
-    std::map<int, std::function<void(int)>> ff;
+    const bool edge;
+    std::unique_ptr<Uring> uring;
+    std::vector<epoll_event> ev;
+    std::vector<char> buf;
+    std::function<void()> idlef;
+    bool stopped = false;
+    Stats st;
+
+    /* The handlers for an fd, indexed by the fd itself. A deque
+     * rather than a vector, since the epoll_event points straight
+     * to the Entry, so growing mustn't move them.
+     *
+     * With io_uring, requests are tagged with the fd and the
+     * generation, so that completions for an fd that has been
+     * forgotten (and maybe reused) can be ignored.
+     *
+     * A paused entry keeps its handlers, but isn't read from.
+     */
+    struct Entry {
+	int fd;
+	unsigned gen;
+	Handler rf;
+	Handler wf;
+	Sink sf;
+	bool paused;
+
+	bool reading() const { return (rf || sf) && !paused; }
+    };
+
+    std::deque<Entry> ff;
+    TimerWheel timers;
+
+    Entry& entry(int fd);
+    Entry& reset(int fd);
+    void ctl(int op, Entry& e, unsigned events);
+    void input(Entry& e);
+    void complete(const io_uring_cqe& cqe);
+    std::uint64_t tag(const Entry& e, unsigned kind) const;
+    int timeout() const;
+    void loop_epoll();
+    void loop_uring();
 };
 
 #endif
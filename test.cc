@@ -0,0 +1,123 @@
+#include <orchis.h>
+namespace splitjoin { void one(orchis::TC); }
+namespace splitjoin { void two(orchis::TC); }
+namespace splitjoin { void empty(orchis::TC); }
+namespace splitjoin { void three(orchis::TC); }
+namespace splitjoin { void limited(orchis::TC); }
+namespace splitjoin { void trailing(orchis::TC); }
+namespace splitjoin { void delimited(orchis::TC); }
+namespace logs { void held(orchis::TC); }
+namespace logs { void types(orchis::TC); }
+namespace logs { void simple(orchis::TC); }
+namespace logs { void largish(orchis::TC); }
+namespace logs { void truncated(orchis::TC); }
+namespace timerwheel { void next_empty(orchis::TC); }
+namespace timerwheel { void laps(orchis::TC); }
+namespace timerwheel { void many(orchis::TC); }
+namespace timerwheel { void next(orchis::TC); }
+namespace timerwheel { void past(orchis::TC); }
+namespace timerwheel { void empty(orchis::TC); }
+namespace timerwheel { void order(orchis::TC); }
+namespace timerwheel { void stale(orchis::TC); }
+namespace timerwheel { void cancel(orchis::TC); }
+namespace timerwheel { void simple(orchis::TC); }
+namespace timerwheel { void next_hint(orchis::TC); }
+namespace timerwheel { void reentrant(orchis::TC); }
+namespace placement { void bad(orchis::TC); }
+namespace placement { void list(orchis::TC); }
+namespace placement { void node(orchis::TC); }
+namespace placement { void range(orchis::TC); }
+namespace placement { void single(orchis::TC); }
+namespace procstat { void comm(orchis::TC); }
+namespace procstat::rate { void empty(orchis::TC); }
+namespace procstat::rate { void window(orchis::TC); }
+namespace procstat::rate { void partial(orchis::TC); }
+namespace procstat { void statm(orchis::TC); }
+namespace procstat { void ioacct(orchis::TC); }
+namespace procstat { void simple(orchis::TC); }
+namespace procstat { void truncated(orchis::TC); }
+namespace notify { void empty(orchis::TC); }
+namespace notify { void ready(orchis::TC); }
+namespace notify { void others(orchis::TC); }
+namespace notify { void sender(orchis::TC); }
+namespace notify { void socket(orchis::TC); }
+namespace notify { void status(orchis::TC); }
+namespace notify { void several(orchis::TC); }
+namespace notify { void watchdog(orchis::TC); }
+namespace sockets { void bad(orchis::TC); }
+namespace sockets { void ipv4(orchis::TC); }
+namespace sockets { void ipv6(orchis::TC); }
+namespace sockets { void socket(orchis::TC); }
+namespace sockets { void wildcard(orchis::TC); }
+namespace textread { void crlf(orchis::TC); }
+namespace textread { void full(orchis::TC); }
+namespace textread { void last(orchis::TC); }
+namespace textread { void pipe(orchis::TC); }
+namespace textread { void lines(orchis::TC); }
+namespace textread { void overlong(orchis::TC); }
+namespace textread { void fragments(orchis::TC); }
+namespace parent { void paced(orchis::TC); }
+namespace parent { void queued(orchis::TC); }
+namespace parent { void longline(orchis::TC); }
+int main(int, char**) { int fail = 0;
+try { splitjoin::one(orchis::TC{}); std::cout << "ok   splitjoin::one\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL splitjoin::one: " << e.s << "\n"; }
+try { splitjoin::two(orchis::TC{}); std::cout << "ok   splitjoin::two\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL splitjoin::two: " << e.s << "\n"; }
+try { splitjoin::empty(orchis::TC{}); std::cout << "ok   splitjoin::empty\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL splitjoin::empty: " << e.s << "\n"; }
+try { splitjoin::three(orchis::TC{}); std::cout << "ok   splitjoin::three\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL splitjoin::three: " << e.s << "\n"; }
+try { splitjoin::limited(orchis::TC{}); std::cout << "ok   splitjoin::limited\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL splitjoin::limited: " << e.s << "\n"; }
+try { splitjoin::trailing(orchis::TC{}); std::cout << "ok   splitjoin::trailing\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL splitjoin::trailing: " << e.s << "\n"; }
+try { splitjoin::delimited(orchis::TC{}); std::cout << "ok   splitjoin::delimited\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL splitjoin::delimited: " << e.s << "\n"; }
+try { logs::held(orchis::TC{}); std::cout << "ok   logs::held\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL logs::held: " << e.s << "\n"; }
+try { logs::types(orchis::TC{}); std::cout << "ok   logs::types\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL logs::types: " << e.s << "\n"; }
+try { logs::simple(orchis::TC{}); std::cout << "ok   logs::simple\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL logs::simple: " << e.s << "\n"; }
+try { logs::largish(orchis::TC{}); std::cout << "ok   logs::largish\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL logs::largish: " << e.s << "\n"; }
+try { logs::truncated(orchis::TC{}); std::cout << "ok   logs::truncated\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL logs::truncated: " << e.s << "\n"; }
+try { timerwheel::next_empty(orchis::TC{}); std::cout << "ok   timerwheel::next_empty\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL timerwheel::next_empty: " << e.s << "\n"; }
+try { timerwheel::laps(orchis::TC{}); std::cout << "ok   timerwheel::laps\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL timerwheel::laps: " << e.s << "\n"; }
+try { timerwheel::many(orchis::TC{}); std::cout << "ok   timerwheel::many\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL timerwheel::many: " << e.s << "\n"; }
+try { timerwheel::next(orchis::TC{}); std::cout << "ok   timerwheel::next\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL timerwheel::next: " << e.s << "\n"; }
+try { timerwheel::past(orchis::TC{}); std::cout << "ok   timerwheel::past\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL timerwheel::past: " << e.s << "\n"; }
+try { timerwheel::empty(orchis::TC{}); std::cout << "ok   timerwheel::empty\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL timerwheel::empty: " << e.s << "\n"; }
+try { timerwheel::order(orchis::TC{}); std::cout << "ok   timerwheel::order\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL timerwheel::order: " << e.s << "\n"; }
+try { timerwheel::stale(orchis::TC{}); std::cout << "ok   timerwheel::stale\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL timerwheel::stale: " << e.s << "\n"; }
+try { timerwheel::cancel(orchis::TC{}); std::cout << "ok   timerwheel::cancel\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL timerwheel::cancel: " << e.s << "\n"; }
+try { timerwheel::simple(orchis::TC{}); std::cout << "ok   timerwheel::simple\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL timerwheel::simple: " << e.s << "\n"; }
+try { timerwheel::next_hint(orchis::TC{}); std::cout << "ok   timerwheel::next_hint\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL timerwheel::next_hint: " << e.s << "\n"; }
+try { timerwheel::reentrant(orchis::TC{}); std::cout << "ok   timerwheel::reentrant\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL timerwheel::reentrant: " << e.s << "\n"; }
+try { placement::bad(orchis::TC{}); std::cout << "ok   placement::bad\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL placement::bad: " << e.s << "\n"; }
+try { placement::list(orchis::TC{}); std::cout << "ok   placement::list\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL placement::list: " << e.s << "\n"; }
+try { placement::node(orchis::TC{}); std::cout << "ok   placement::node\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL placement::node: " << e.s << "\n"; }
+try { placement::range(orchis::TC{}); std::cout << "ok   placement::range\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL placement::range: " << e.s << "\n"; }
+try { placement::single(orchis::TC{}); std::cout << "ok   placement::single\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL placement::single: " << e.s << "\n"; }
+try { procstat::comm(orchis::TC{}); std::cout << "ok   procstat::comm\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL procstat::comm: " << e.s << "\n"; }
+try { procstat::rate::empty(orchis::TC{}); std::cout << "ok   procstat::rate::empty\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL procstat::rate::empty: " << e.s << "\n"; }
+try { procstat::rate::window(orchis::TC{}); std::cout << "ok   procstat::rate::window\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL procstat::rate::window: " << e.s << "\n"; }
+try { procstat::rate::partial(orchis::TC{}); std::cout << "ok   procstat::rate::partial\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL procstat::rate::partial: " << e.s << "\n"; }
+try { procstat::statm(orchis::TC{}); std::cout << "ok   procstat::statm\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL procstat::statm: " << e.s << "\n"; }
+try { procstat::ioacct(orchis::TC{}); std::cout << "ok   procstat::ioacct\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL procstat::ioacct: " << e.s << "\n"; }
+try { procstat::simple(orchis::TC{}); std::cout << "ok   procstat::simple\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL procstat::simple: " << e.s << "\n"; }
+try { procstat::truncated(orchis::TC{}); std::cout << "ok   procstat::truncated\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL procstat::truncated: " << e.s << "\n"; }
+try { notify::empty(orchis::TC{}); std::cout << "ok   notify::empty\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL notify::empty: " << e.s << "\n"; }
+try { notify::ready(orchis::TC{}); std::cout << "ok   notify::ready\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL notify::ready: " << e.s << "\n"; }
+try { notify::others(orchis::TC{}); std::cout << "ok   notify::others\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL notify::others: " << e.s << "\n"; }
+try { notify::sender(orchis::TC{}); std::cout << "ok   notify::sender\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL notify::sender: " << e.s << "\n"; }
+try { notify::socket(orchis::TC{}); std::cout << "ok   notify::socket\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL notify::socket: " << e.s << "\n"; }
+try { notify::status(orchis::TC{}); std::cout << "ok   notify::status\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL notify::status: " << e.s << "\n"; }
+try { notify::several(orchis::TC{}); std::cout << "ok   notify::several\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL notify::several: " << e.s << "\n"; }
+try { notify::watchdog(orchis::TC{}); std::cout << "ok   notify::watchdog\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL notify::watchdog: " << e.s << "\n"; }
+try { sockets::bad(orchis::TC{}); std::cout << "ok   sockets::bad\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL sockets::bad: " << e.s << "\n"; }
+try { sockets::ipv4(orchis::TC{}); std::cout << "ok   sockets::ipv4\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL sockets::ipv4: " << e.s << "\n"; }
+try { sockets::ipv6(orchis::TC{}); std::cout << "ok   sockets::ipv6\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL sockets::ipv6: " << e.s << "\n"; }
+try { sockets::socket(orchis::TC{}); std::cout << "ok   sockets::socket\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL sockets::socket: " << e.s << "\n"; }
+try { sockets::wildcard(orchis::TC{}); std::cout << "ok   sockets::wildcard\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL sockets::wildcard: " << e.s << "\n"; }
+try { textread::crlf(orchis::TC{}); std::cout << "ok   textread::crlf\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL textread::crlf: " << e.s << "\n"; }
+try { textread::full(orchis::TC{}); std::cout << "ok   textread::full\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL textread::full: " << e.s << "\n"; }
+try { textread::last(orchis::TC{}); std::cout << "ok   textread::last\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL textread::last: " << e.s << "\n"; }
+try { textread::pipe(orchis::TC{}); std::cout << "ok   textread::pipe\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL textread::pipe: " << e.s << "\n"; }
+try { textread::lines(orchis::TC{}); std::cout << "ok   textread::lines\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL textread::lines: " << e.s << "\n"; }
+try { textread::overlong(orchis::TC{}); std::cout << "ok   textread::overlong\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL textread::overlong: " << e.s << "\n"; }
+try { textread::fragments(orchis::TC{}); std::cout << "ok   textread::fragments\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL textread::fragments: " << e.s << "\n"; }
+try { parent::paced(orchis::TC{}); std::cout << "ok   parent::paced\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL parent::paced: " << e.s << "\n"; }
+try { parent::queued(orchis::TC{}); std::cout << "ok   parent::queued\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL parent::queued: " << e.s << "\n"; }
+try { parent::longline(orchis::TC{}); std::cout << "ok   parent::longline\n"; } catch (orchis::Failure& e) { fail++; std::cout << "FAIL parent::longline: " << e.s << "\n"; }
+std::cout << fail << " failures\n"; return fail != 0; }
@@ -0,0 +1,77 @@
+#include <listen.h>
+
+#include <orchis.h>
+
+#include <sstream>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace sockets {
+
+    using orchis::TC;
+
+    void assert_ep(const std::string& s,
+		   const std::string& host, const std::string& port,
+		   const std::string& ref)
+    {
+	Endpoint ep;
+	orchis::assert_true(endpoint(ep, s));
+	orchis::assert_eq(ep.host, host);
+	orchis::assert_eq(ep.port, port);
+	std::ostringstream oss;
+	oss << ep;
+	orchis::assert_eq(oss.str(), ref);
+    }
+
+    void assert_bad(const std::string& s)
+    {
+	Endpoint ep;
+	orchis::assert_false(endpoint(ep, s));
+    }
+
+    void ipv4(TC)
+    {
+	assert_ep("tcp:0.0.0.0:8080", "0.0.0.0", "8080", "tcp:0.0.0.0:8080");
+	assert_ep("tcp:localhost:http", "localhost", "http", "tcp:localhost:http");
+    }
+
+    void ipv6(TC)
+    {
+	assert_ep("tcp:[::1]:80", "::1", "80", "tcp:[::1]:80");
+	assert_ep("tcp:[::]:80", "::", "80", "tcp:[::]:80");
+    }
+
+    void wildcard(TC)
+    {
+	assert_ep("tcp:8080", "", "8080", "tcp:*:8080");
+	assert_ep("tcp:*:8080", "", "8080", "tcp:*:8080");
+    }
+
+    void bad(TC)
+    {
+	assert_bad("");
+	assert_bad("tcp:");
+	assert_bad("udp:0.0.0.0:53");
+	assert_bad("8080");
+	assert_bad("tcp::8080");
+	assert_bad("tcp:host:");
+	assert_bad("tcp:::1:80");
+	assert_bad("tcp:[::1]");
+	assert_bad("tcp:[]:80");
+    }
+
+    void socket(TC)
+    {
+	std::ostringstream err;
+	const int fd = listening_socket(err, "127.0.0.1", "0", 5, 0);
+	orchis::assert_neq(fd, -1);
+	orchis::assert_eq(err.str(), "");
+
+	int val = 0;
+	socklen_t len = sizeof val;
+	orchis::assert_eq(getsockopt(fd, SOL_SOCKET, SO_ACCEPTCONN, &val, &len), 0);
+	orchis::assert_eq(val, 1);
+	close(fd);
+    }
+}
@@ -86,4 +86,21 @@ namespace logs {
 	Info(Syslog::log) << "foo";
 	assert_log(sfd, "foo");
     }
+
+    /* Held-back messages are written when committed, in order.
+     */
+    void held(TC)
+    {
+	Stealfd sfd {1};
+	Syslog::log.hold(true);
+	Info(Syslog::log) << "foo";
+	Info(Syslog::log) << "bar";
+	orchis::assert_eq(sfd.drain(), "");
+	Syslog::log.commit();
+	const auto v = split(sfd.drain());
+	Syslog::log.hold(false);
+	orchis::assert_eq(v.size(), 4);
+	orchis::assert_eq(v[1], "foo");
+	orchis::assert_eq(v[3], "bar");
+    }
 }
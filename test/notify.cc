@@ -0,0 +1,127 @@
+#include <notify.h>
+
+#include <orchis.h>
+
+#include <cstring>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace notify {
+
+    using orchis::TC;
+
+    Notification parse(const char* s)
+    {
+	return ::parse(s, s + std::strlen(s));
+    }
+
+    void empty(TC)
+    {
+	const auto n = parse("");
+	orchis::assert_false(n.ready);
+	orchis::assert_false(n.watchdog);
+	orchis::assert_false(n.has_status);
+    }
+
+    void ready(TC)
+    {
+	orchis::assert_true(parse("READY=1").ready);
+	orchis::assert_true(parse("READY=1\n").ready);
+	orchis::assert_false(parse("READY=0").ready);
+	orchis::assert_false(parse("READY=11").ready);
+    }
+
+    void several(TC)
+    {
+	const auto n = parse("READY=1\nSTATUS=Processing requests\nMAINPID=4711\n");
+	orchis::assert_true(n.ready);
+	orchis::assert_false(n.watchdog);
+	orchis::assert_true(n.has_status);
+	orchis::assert_eq(n.status, "Processing requests");
+    }
+
+    void watchdog(TC)
+    {
+	const auto n = parse("WATCHDOG=1");
+	orchis::assert_false(n.ready);
+	orchis::assert_true(n.watchdog);
+    }
+
+    void status(TC)
+    {
+	auto n = parse("STATUS=");
+	orchis::assert_true(n.has_status);
+	orchis::assert_eq(n.status, "");
+	n = parse("STATUS=a\nSTATUS=b=c\n");
+	orchis::assert_eq(n.status, "b=c");
+    }
+
+    void socket(TC)
+    {
+	NotifySocket ns;
+	orchis::assert_true(ns.valid());
+	orchis::assert_eq(ns.address.size(), 6);
+	orchis::assert_eq(ns.address[0], '@');
+    }
+
+    void sender(TC)
+    {
+	NotifySocket ns;
+	orchis::assert_true(ns.valid());
+
+	sockaddr_un sa = {};
+	sa.sun_family = AF_UNIX;
+	std::memcpy(sa.sun_path + 1, ns.address.data() + 1, ns.address.size() - 1);
+	const socklen_t len = offsetof(sockaddr_un, sun_path) + ns.address.size();
+	const int fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+	orchis::assert_eq(sendto(fd, "READY=1", 7, 0,
+				 reinterpret_cast<sockaddr*>(&sa), len), 7);
+	close(fd);
+
+	char buf[100];
+	pid_t pid;
+	orchis::assert_eq(ns.recv(buf, sizeof buf, pid), 7);
+	orchis::assert_eq(pid, getpid());
+	orchis::assert_eq(ns.recv(buf, sizeof buf, pid), -1);
+    }
+
+    void send(const NotifySocket& ns, const char* s)
+    {
+	sockaddr_un sa = {};
+	sa.sun_family = AF_UNIX;
+	std::memcpy(sa.sun_path + 1, ns.address.data() + 1, ns.address.size() - 1);
+	const socklen_t len = offsetof(sockaddr_un, sun_path) + ns.address.size();
+	const int fd = ::socket(AF_UNIX, SOCK_DGRAM, 0);
+	sendto(fd, s, std::strlen(s), 0, reinterpret_cast<sockaddr*>(&sa), len);
+	close(fd);
+    }
+
+    /* Datagrams from other processes than the one we listen to are
+     * ignored.
+     */
+    void others(TC)
+    {
+	NotifySocket ns;
+	orchis::assert_true(ns.valid());
+
+	send(ns, "READY=1");
+	const pid_t child = fork();
+	if (!child) {
+	    send(ns, "STATUS=child");
+	    _exit(0);
+	}
+	waitpid(child, nullptr, 0);
+	send(ns, "WATCHDOG=1");
+
+	char buf[100];
+	orchis::assert_eq(ns.recv_from(buf, sizeof buf, child), 12);
+	orchis::assert_eq(std::string(buf, 12), "STATUS=child");
+	orchis::assert_eq(ns.recv_from(buf, sizeof buf, child), -1);
+
+	send(ns, "READY=1");
+	orchis::assert_eq(ns.recv_from(buf, sizeof buf, 0), -1);
+    }
+}
@@ -0,0 +1,166 @@
+/* Copyright (c) 2024 Jrgen Grahn
+ * All rights reserved.
+ *
+ */
+#include <parent.h>
+
+#include "stealfd.h"
+
+#include <orchis.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+namespace parent {
+
+    using orchis::TC;
+    using namespace std::chrono_literals;
+
+    /* A config file with the text 's', for as long as it exists.
+     */
+    struct Config {
+	explicit Config(const std::string& s)
+	{
+	    char name[] = "/tmp/djcl-test.XXXXXX";
+	    const int fd = mkstemp(name);
+	    close(fd);
+	    path = name;
+	    std::ofstream {path} << s;
+	}
+	~Config() { unlink(path.c_str()); }
+	std::string path;
+    };
+
+    unsigned count(const std::string& s, const std::string& needle)
+    {
+	unsigned n = 0;
+	for (auto i = s.find(needle); i != s.npos; i = s.find(needle, i + 1)) n++;
+	return n;
+    }
+
+    /* Run the event loop for a while. It can't run again after that.
+     */
+    void run(Spider& spider, std::chrono::milliseconds d)
+    {
+	spider.after(d, [&spider] { spider.stop(); });
+	spider.loop();
+    }
+
+    /* Stopping everything while some programs are queued to start,
+     * because of --start-rate, cancels those starts.
+     */
+    void paced(TC)
+    {
+	Stealfd sfd {1};
+	const Config config {"a.exec = sleep 10\n"
+			     "a.instances = 5\n"
+			     "a.stop-signal = TERM\n"};
+	const Schedule schedule {std::cerr, config.path};
+	orchis::assert_true(schedule.valid());
+	const Cgroups cgroups {""};
+	const Sockets sockets {std::cerr, schedule};
+	Spider spider;
+	Parent parent {schedule, Syslog::log, spider, {0, 1}, cgroups, sockets, 0};
+
+	std::ostringstream os;
+	std::string reply;
+	orchis::assert_true(parent.stop_all(os, [&] (const std::string& s) { reply = s; }));
+	orchis::assert_eq(os.str(), "");
+	run(spider, 1500ms);
+
+	orchis::assert_eq(reply, "ok stopped 1 programs; cancelled 4 pending starts");
+	orchis::assert_eq(count(sfd.drain(), "started a@"), 1);
+	parent.list(os);
+	orchis::assert_eq(count(os.str(), "queued"), 0);
+    }
+
+    /* The same, for a single program.
+     */
+    void queued(TC)
+    {
+	Stealfd sfd {1};
+	const Config config {"a.exec = sleep 10\n"
+			     "a.stop-signal = TERM\n"
+			     "b.exec = sleep 10\n"
+			     "b.stop-signal = TERM\n"};
+	const Schedule schedule {std::cerr, config.path};
+	orchis::assert_true(schedule.valid());
+	const Cgroups cgroups {""};
+	const Sockets sockets {std::cerr, schedule};
+	Spider spider;
+	Parent parent {schedule, Syslog::log, spider, {0, 1}, cgroups, sockets, 0};
+
+	std::ostringstream os;
+	orchis::assert_false(parent.stop(os, "b"));
+	orchis::assert_eq(os.str(), "ok cancelled start of b");
+	os.str("");
+	orchis::assert_false(parent.stop(os, "a"));
+	orchis::assert_eq(os.str(), "ok");
+	run(spider, 1500ms);
+
+	const std::string log = sfd.drain();
+	orchis::assert_eq(count(log, "started "), 1);
+	orchis::assert_eq(count(log, "started b"), 0);
+    }
+
+    /* A line of a few MB on stdout reaches the log in order, in
+     * pieces, and doesn't look like the pipe closing.
+     */
+    void longline(TC)
+    {
+	Stealfd sfd {1};
+	const Config script {"seq 400000 | tr -d '\\n'\n"
+			     "echo\n"
+			     "echo after\n"
+			     "exec sleep 10\n"};
+	const Config config {"a.exec = sh " + script.path + "\n"
+			     "a.stop-signal = TERM\n"};
+	const Schedule schedule {std::cerr, config.path};
+	orchis::assert_true(schedule.valid());
+	const Cgroups cgroups {""};
+	const Sockets sockets {std::cerr, schedule};
+	Spider spider;
+	Parent parent {schedule, Syslog::log, spider, {0, 1}, cgroups, sockets, 0};
+	run(spider, 3000ms);
+
+	std::ostringstream os;
+	parent.stop(os, "a");
+
+	std::string expected;
+	for (unsigned i = 1; i <= 400000; i++) expected += std::to_string(i);
+
+	std::istringstream is {sfd.drain()};
+	std::vector<std::string> lines;
+	std::string line;
+	std::string s;
+	unsigned pieces = 0;
+	while (std::getline(is, line)) {
+	    orchis::assert_eq(count(line, "a: stdout: EOF"), 0);
+	    const auto i = line.find(" a: stdout");
+	    if (i==line.npos) continue;
+	    const auto j = line.find(": ", i + 3);
+	    const std::string tag = line.substr(i + 4, j - i - 4);
+	    const std::string text = line.substr(j + 2);
+	    if (tag=="stdout") lines.push_back(text);
+	    else {
+		orchis::assert_eq(tag, "stdout+");
+		orchis::assert_false(lines.empty());
+		lines.back() += text;
+	    }
+	    orchis::assert_lt(text.size(), Syslog::capacity);
+	    pieces++;
+	}
+
+	orchis::assert_eq(lines.size(), 2);
+	orchis::assert_eq(lines[0].size(), expected.size());
+	orchis::assert_true(lines[0]==expected);
+	orchis::assert_eq(lines[1], "after");
+	orchis::assert_gt(pieces, expected.size() / Syslog::capacity);
+    }
+}
@@ -0,0 +1,80 @@
+#include <placement.h>
+
+#include <orchis.h>
+
+#include <sstream>
+
+namespace placement {
+
+    using orchis::TC;
+
+    std::string str(const Placement& where)
+    {
+	std::ostringstream oss;
+	oss << where;
+	return oss.str();
+    }
+
+    void assert_cpus(const std::string& s, const std::string& ref)
+    {
+	Placement where;
+	orchis::assert_true(cpulist(where.cpus, s));
+	orchis::assert_eq(str(where), ref);
+    }
+
+    void assert_bad(const std::string& s)
+    {
+	std::vector<unsigned> v {4711};
+	orchis::assert_false(cpulist(v, s));
+	orchis::assert_eq(v.size(), 1);
+    }
+
+    void single(TC)
+    {
+	assert_cpus("0", "cpus 0");
+	assert_cpus("7", "cpus 7");
+	assert_cpus("1023", "cpus 1023");
+    }
+
+    void range(TC)
+    {
+	assert_cpus("2-5", "cpus 2-5");
+	assert_cpus("2-2", "cpus 2");
+	assert_cpus("2-3", "cpus 2-3");
+    }
+
+    void list(TC)
+    {
+	assert_cpus("2-5,8", "cpus 2-5,8");
+	assert_cpus("0,2,4", "cpus 0,2,4");
+	assert_cpus("8,2-5", "cpus 2-5,8");
+	assert_cpus("2-5,6", "cpus 2-6");
+	assert_cpus("2-5,3-7", "cpus 2-7");
+    }
+
+    void bad(TC)
+    {
+	assert_bad("");
+	assert_bad(",");
+	assert_bad("a");
+	assert_bad("-1");
+	assert_bad("1-");
+	assert_bad("5-2");
+	assert_bad("1,,2");
+	assert_bad(" 1");
+	assert_bad("1024");
+	assert_bad("0-1024");
+    }
+
+    void node(TC)
+    {
+	Placement where;
+	orchis::assert_true(where.empty());
+	orchis::assert_eq(str(where), "");
+	where.node = 1;
+	orchis::assert_false(where.empty());
+	orchis::assert_eq(str(where), "node 1");
+	where.cpus = {3, 4, 5};
+	orchis::assert_eq(str(where), "cpus 3-5 node 1");
+    }
+}
@@ -0,0 +1,119 @@
+#include <procstat.h>
+
+#include <orchis.h>
+
+#include <cstring>
+#include <unistd.h>
+
+namespace procstat {
+
+    using orchis::TC;
+    using Sample = ProcStat::Sample;
+
+    bool stat(Sample& s, const char* text)
+    {
+	return parse_stat(s, text, text + std::strlen(text));
+    }
+
+    bool io(Sample& s, const char* text)
+    {
+	return parse_io(s, text, text + std::strlen(text));
+    }
+
+    void simple(TC)
+    {
+	Sample s;
+	orchis::assert_true(stat(s, "4711 (sleep) S 1 4711 4711 0 -1 4194560 "
+				 "97 0 0 0 12 30 0 0 20 0 1 0 1234 "
+				 "8503296 256 18446744073709551615\n"));
+	orchis::assert_eq(s.ticks, 42);
+    }
+
+    void comm(TC)
+    {
+	Sample s;
+	orchis::assert_true(stat(s, "4711 (a) b) (c) R 1 4711 4711 0 -1 0 "
+				 "0 0 0 0 100 1 0 0 20 0 1 0 1234\n"));
+	orchis::assert_eq(s.ticks, 101);
+    }
+
+    void truncated(TC)
+    {
+	Sample s;
+	orchis::assert_false(stat(s, ""));
+	orchis::assert_false(stat(s, "4711 (sleep"));
+	orchis::assert_false(stat(s, "4711 (sleep) S 1 4711 4711 0 -1 0 0 0 0 0"));
+    }
+
+    void statm(TC)
+    {
+	Sample s;
+	const char text[] = "2076 256 224 4 0 88 0\n";
+	orchis::assert_true(parse_statm(s, text, text + sizeof text - 1));
+	orchis::assert_eq(s.rss, 256 * sysconf(_SC_PAGESIZE));
+    }
+
+    void ioacct(TC)
+    {
+	Sample s;
+	orchis::assert_true(io(s, "rchar: 1948\n"
+			       "wchar: 0\n"
+			       "syscr: 7\n"
+			       "syscw: 0\n"
+			       "read_bytes: 4096\n"
+			       "write_bytes: 8192\n"
+			       "cancelled_write_bytes: 0\n"));
+	orchis::assert_eq(s.read, 4096);
+	orchis::assert_eq(s.write, 8192);
+	orchis::assert_false(io(s, ""));
+    }
+
+    namespace rate {
+
+	using std::chrono::seconds;
+
+	Sample at(int t, unsigned long long ticks, unsigned long long write)
+	{
+	    Sample s;
+	    s.t = std::chrono::steady_clock::time_point {} + seconds {t};
+	    s.ticks = ticks;
+	    s.write = write;
+	    return s;
+	}
+
+	void empty(TC)
+	{
+	    Samples ss {seconds {60}};
+	    orchis::assert_true(ss.rate(seconds {10}).d == seconds {0});
+	    ss.add(at(0, 0, 0));
+	    orchis::assert_true(ss.rate(seconds {10}).d == seconds {0});
+	}
+
+	void window(TC)
+	{
+	    const double hz = sysconf(_SC_CLK_TCK);
+	    Samples ss {seconds {60}};
+	    for (int t = 0; t <= 100; t++) {
+		ss.add(at(t, t * hz / 2, t < 90 ? 0 : 1024 * (t - 90)));
+	    }
+	    auto r = ss.rate(seconds {10});
+	    orchis::assert_true(r.d == seconds {10});
+	    orchis::assert_eq(r.cpu, 50);
+	    orchis::assert_eq(r.write, 1024);
+
+	    r = ss.rate(seconds {60});
+	    orchis::assert_true(r.d == seconds {60});
+	    orchis::assert_eq(r.cpu, 50);
+
+	    r = ss.rate(seconds {100});
+	    orchis::assert_true(r.d == seconds {60});
+	}
+
+	void partial(TC)
+	{
+	    Samples ss {seconds {60}};
+	    for (int t = 0; t <= 3; t++) ss.add(at(t, 0, 0));
+	    orchis::assert_true(ss.rate(seconds {10}).d == seconds {3});
+	}
+    }
+}
@@ -0,0 +1,175 @@
+#include <textread.h>
+
+#include <orchis.h>
+
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace textread {
+
+    using orchis::TC;
+    using sockutil::TextReader;
+
+    /* Feed all of 's' to 'tr' (with EOF if 'eof'), and read whatever
+     * comes out of it.
+     */
+    std::vector<std::string> feed(TextReader& tr, const std::string& s,
+				  bool eof = false)
+    {
+	std::vector<std::string> v;
+	const char* a = s.data();
+	const char* const b = a + s.size();
+	do {
+	    a += tr.feed(a, b);
+	    std::string line;
+	    while ((line = tr.read()).size()) v.push_back(line);
+	} while (a != b && !tr.eof());
+
+	if (eof) {
+	    tr.feed(b, b);
+	    std::string line;
+	    while ((line = tr.read()).size()) v.push_back(line);
+	}
+	return v;
+    }
+
+    std::string join(const std::vector<std::string>& v)
+    {
+	std::string s;
+	for (const auto& line : v) s += line;
+	return s;
+    }
+
+    void lines(TC)
+    {
+	TextReader tr {"\n"};
+	const auto v = feed(tr, "foo\nbar\n\nbaz");
+	orchis::assert_eq(v.size(), 3);
+	orchis::assert_eq(v[0], "foo\n");
+	orchis::assert_eq(v[1], "bar\n");
+	orchis::assert_eq(v[2], "\n");
+	orchis::assert_false(tr.eof());
+	orchis::assert_eq(feed(tr, "\n").front(), "baz\n");
+    }
+
+    void last(TC)
+    {
+	TextReader tr {"\n"};
+	const auto v = feed(tr, "foo\nbar", true);
+	orchis::assert_eq(v.size(), 2);
+	orchis::assert_eq(v[1], "bar");
+	orchis::assert_true(tr.eof());
+    }
+
+    /* A full buffer, with nothing read() from it, is left alone.
+     */
+    void full(TC)
+    {
+	int fd[2];
+	orchis::assert_eq(::pipe2(fd, O_NONBLOCK), 0);
+	std::string s;
+	while (s.size() < 10000) s += "foo\n";
+	orchis::assert_eq(write(fd[1], s.data(), s.size()), s.size());
+
+	TextReader tr {"\n"};
+	while (tr.feed(fd[0])) ;
+	orchis::assert_false(tr.eof());
+
+	std::string t;
+	std::string line;
+	while ((line = tr.read()).size()) t += line;
+	orchis::assert_eq(t.size(), 8000);
+	while (tr.feed(fd[0])) ;
+	while ((line = tr.read()).size()) t += line;
+	orchis::assert_true(t==s);
+	orchis::assert_false(tr.eof());
+
+	close(fd[1]);
+	orchis::assert_false(tr.feed(fd[0]));
+	orchis::assert_true(tr.eof());
+	close(fd[0]);
+    }
+
+    void overlong(TC)
+    {
+	TextReader tr {"\n"};
+	const auto v = feed(tr, "foo\n" + std::string(10000, 'x') + "\nbar\n");
+	orchis::assert_eq(v.size(), 1);
+	orchis::assert_true(tr.eof());
+    }
+
+    void fragments(TC)
+    {
+	TextReader tr {"\n", true};
+	const std::string line = std::string(3 * 1024 * 1024, 'x') + '\n';
+	const auto v = feed(tr, "foo\n" + line + "bar\n");
+
+	orchis::assert_false(tr.eof());
+	orchis::assert_gt(v.size(), 3);
+	orchis::assert_eq(v.front(), "foo\n");
+	orchis::assert_eq(v.back(), "bar\n");
+	for (size_t i = 1; i < v.size() - 2; i++) {
+	    orchis::assert_eq(v[i].size(), 8000);
+	    orchis::assert_eq(v[i].back(), 'x');
+	}
+	orchis::assert_eq(v[v.size() - 2].back(), '\n');
+	orchis::assert_true(join(v)=="foo\n" + line + "bar\n");
+    }
+
+    void crlf(TC)
+    {
+	TextReader tr {"\r\n", true};
+	const auto v = feed(tr, std::string(7999, 'x') + "\r\nfoo\r\n");
+	orchis::assert_eq(v.size(), 3);
+	orchis::assert_eq(v[0], std::string(7999, 'x'));
+	orchis::assert_eq(v[1], "\r\n");
+	orchis::assert_eq(v[2], "foo\r\n");
+    }
+
+    /* Lines of several megabytes, through a pipe, interleaving
+     * writing and reading, since the pipe holds a lot less.
+     */
+    void pipe(TC)
+    {
+	std::string s;
+	for (unsigned n : {5, 4000000, 8000, 7999, 8001, 2500000, 0, 10}) {
+	    for (unsigned i = 0; i < n; i++) s.push_back('a' + i % 26);
+	    s.push_back('\n');
+	}
+
+	int fd[2];
+	orchis::assert_eq(::pipe2(fd, O_NONBLOCK), 0);
+
+	TextReader tr {"\n", true};
+	std::string out;
+	unsigned lines = 0;
+	size_t n = 0;
+	while (!tr.eof()) {
+	    if (n < s.size()) {
+		const ssize_t rc = write(fd[1], s.data() + n, s.size() - n);
+		if (rc > 0) n += rc;
+	    }
+	    else if (fd[1] != -1) {
+		close(fd[1]);
+		fd[1] = -1;
+	    }
+
+	    while (tr.feed(fd[0])) {
+		std::string line;
+		while ((line = tr.read()).size()) {
+		    orchis::assert_le(line.size(), 8000);
+		    if (line.back()=='\n') lines++;
+		    out += line;
+		}
+	    }
+	}
+	close(fd[0]);
+
+	orchis::assert_eq(tr.error(), 0);
+	orchis::assert_eq(lines, 8);
+	orchis::assert_true(out==s);
+    }
+}
@@ -0,0 +1,183 @@
+#include <timerwheel.h>
+
+#include <orchis.h>
+
+#include <string>
+
+namespace timerwheel {
+
+    using orchis::TC;
+    using Clock = TimerWheel::Clock;
+    using ms = std::chrono::milliseconds;
+
+    const Clock::time_point t0 {};
+
+    void empty(TC)
+    {
+	TimerWheel tw {t0, ms{10}, 8};
+	orchis::assert_true(tw.empty());
+	tw.advance(t0 + ms{1000});
+	orchis::assert_true(tw.empty());
+    }
+
+    void simple(TC)
+    {
+	TimerWheel tw {t0, ms{10}, 8};
+	std::string s;
+	tw.add(t0 + ms{25}, [&] { s += 'a'; });
+	orchis::assert_eq(tw.size(), 1);
+
+	tw.advance(t0 + ms{20});
+	orchis::assert_eq(s, "");
+	tw.advance(t0 + ms{29});
+	orchis::assert_eq(s, "");
+	tw.advance(t0 + ms{30});
+	orchis::assert_eq(s, "a");
+	orchis::assert_true(tw.empty());
+    }
+
+    void order(TC)
+    {
+	TimerWheel tw {t0, ms{10}, 8};
+	std::string s;
+	tw.add(t0 + ms{50}, [&] { s += 'c'; });
+	tw.add(t0 + ms{10}, [&] { s += 'a'; });
+	tw.add(t0 + ms{30}, [&] { s += 'b'; });
+	tw.advance(t0 + ms{100});
+	orchis::assert_eq(s, "abc");
+    }
+
+    void past(TC)
+    {
+	TimerWheel tw {t0, ms{10}, 8};
+	tw.advance(t0 + ms{100});
+	std::string s;
+	tw.add(t0, [&] { s += 'a'; });
+	tw.advance(t0 + ms{100});
+	orchis::assert_eq(s, "");
+	tw.advance(t0 + ms{110});
+	orchis::assert_eq(s, "a");
+    }
+
+    /* Timers further away than a lap around the wheel.
+     */
+    void laps(TC)
+    {
+	TimerWheel tw {t0, ms{10}, 8};
+	std::string s;
+	tw.add(t0 + ms{10}, [&] { s += 'a'; });
+	tw.add(t0 + ms{90}, [&] { s += 'b'; });
+	tw.add(t0 + ms{170}, [&] { s += 'c'; });
+	tw.advance(t0 + ms{10});
+	orchis::assert_eq(s, "a");
+	tw.advance(t0 + ms{89});
+	orchis::assert_eq(s, "a");
+	tw.advance(t0 + ms{90});
+	orchis::assert_eq(s, "ab");
+	tw.advance(t0 + ms{10000});
+	orchis::assert_eq(s, "abc");
+    }
+
+    void cancel(TC)
+    {
+	TimerWheel tw {t0, ms{10}, 8};
+	std::string s;
+	auto a = tw.add(t0 + ms{10}, [&] { s += 'a'; });
+	auto b = tw.add(t0 + ms{10}, [&] { s += 'b'; });
+	orchis::assert_true(tw.cancel(a));
+	orchis::assert_false(bool(a));
+	orchis::assert_false(tw.cancel(a));
+	tw.advance(t0 + ms{10});
+	orchis::assert_eq(s, "b");
+	orchis::assert_false(tw.cancel(b));
+	orchis::assert_true(tw.empty());
+    }
+
+    /* A stale handle doesn't cancel a new timer which happens to
+     * reuse the same node.
+     */
+    void stale(TC)
+    {
+	TimerWheel tw {t0, ms{10}, 8};
+	std::string s;
+	auto a = tw.add(t0 + ms{10}, [&] { s += 'a'; });
+	auto a2 = a;
+	tw.cancel(a);
+	tw.add(t0 + ms{10}, [&] { s += 'b'; });
+	orchis::assert_false(tw.cancel(a2));
+	tw.advance(t0 + ms{10});
+	orchis::assert_eq(s, "b");
+    }
+
+    /* Timers adding and cancelling timers as they fire.
+     */
+    void reentrant(TC)
+    {
+	TimerWheel tw {t0, ms{10}, 8};
+	std::string s;
+	TimerWheel::Timer b;
+	tw.add(t0 + ms{10}, [&] {
+			       s += 'a';
+			       tw.cancel(b);
+			       tw.add(t0 + ms{20}, [&] { s += 'c'; });
+			   });
+	b = tw.add(t0 + ms{10}, [&] { s += 'b'; });
+	tw.advance(t0 + ms{10});
+	orchis::assert_eq(s, "a");
+	tw.advance(t0 + ms{20});
+	orchis::assert_eq(s, "ac");
+    }
+
+    void next(TC)
+    {
+	TimerWheel tw {t0, ms{10}, 8};
+	tw.add(t0 + ms{35}, [] {});
+	orchis::assert_true(tw.next() == t0 + ms{40});
+	tw.advance(t0 + ms{40});
+	orchis::assert_true(tw.empty());
+    }
+
+    void next_empty(TC)
+    {
+	TimerWheel tw {t0, ms{10}, 8};
+	orchis::assert_true(tw.next() == t0 + ms{80});
+	tw.advance(t0 + ms{100});
+	orchis::assert_true(tw.next() == t0 + ms{180});
+    }
+
+    /* next() remembers where it found something, but not past a
+     * timer added or cancelled since.
+     */
+    void next_hint(TC)
+    {
+	TimerWheel tw {t0, ms{10}, 8};
+	auto a = tw.add(t0 + ms{30}, [] {});
+	tw.add(t0 + ms{60}, [] {});
+	orchis::assert_true(tw.next() == t0 + ms{30});
+	tw.add(t0 + ms{20}, [] {});
+	orchis::assert_true(tw.next() == t0 + ms{20});
+	tw.advance(t0 + ms{20});
+	tw.cancel(a);
+	orchis::assert_true(tw.next() == t0 + ms{60});
+	tw.add(t0 + ms{40}, [] {});
+	orchis::assert_true(tw.next() == t0 + ms{40});
+	tw.advance(t0 + ms{60});
+	orchis::assert_true(tw.empty());
+	orchis::assert_true(tw.next() == t0 + ms{140});
+    }
+
+    void many(TC)
+    {
+	TimerWheel tw {t0, ms{1}, 64};
+	unsigned n = 0;
+	std::vector<TimerWheel::Timer> v;
+	for (unsigned i = 0; i < 20000; i++) {
+	    v.push_back(tw.add(t0 + ms{i % 1000}, [&] { n++; }));
+	}
+	for (unsigned i = 0; i < v.size(); i += 2) tw.cancel(v[i]);
+	orchis::assert_eq(tw.size(), 10000);
+	tw.advance(t0 + ms{1000});
+	orchis::assert_eq(n, 10000);
+	orchis::assert_true(tw.empty());
+    }
+}
@@ -15,8 +15,9 @@
 using namespace sockutil;
 
 
-TextReader::TextReader(const std::string& endline)
+TextReader::TextReader(const std::string& endline, bool fragments)
     : endline_(endline),
+      fragments_(fragments),
       p_(buf),
       q_(p_+sizeof buf),
       a_(p_),
@@ -28,6 +29,7 @@ TextReader::TextReader(const std::string& endline)
 
 TextReader::TextReader(const TextReader& other)
     : endline_(other.endline_),
+      fragments_(other.fragments_),
       p_(buf),
       q_(p_+sizeof buf),
       a_(p_),
@@ -42,6 +44,7 @@ TextReader::TextReader(const TextReader& other)
 TextReader& TextReader::operator= (const TextReader& other)
 {
     endline_ = other.endline_;
+    fragments_ = other.fragments_;
     a_ = p_;
     b_ = p_ + (other.b_-other.a_);
     eof_ = other.eof_;
@@ -51,7 +54,7 @@ TextReader& TextReader::operator= (const TextReader& other)
 }
 
 
-void TextReader::feed(int fd)
+bool TextReader::feed(int fd)
 {
     if(a_!=b_ && a_!=p_) {
 	std::copy(a_, b_, p_);
@@ -59,26 +62,56 @@ void TextReader::feed(int fd)
     b_ -= (a_-p_);
     a_ = p_;
 
+    if(b_==q_) return false;
+
     const ssize_t n = ::read(fd, b_, q_-b_);
     if(n==-1) {
 	switch(errno) {
-	case EAGAIN:
 	case EINTR:
+	    return true;
+	case EAGAIN:
 	    break;
 	default:
 	    eof_ = true;
 	    errno_ = errno;
 	}
+	return false;
     }
     else if(n==0) {
 	eof_ = true;
+	return false;
     }
     else {
 	b_+=n;
+	return true;
     }
 }
 
 
+/**
+ * Like feed(fd), but with data which has been read already. Returns
+ * the number of octets consumed, which may be less than offered if
+ * the buffer fills up. Offering none means EOF.
+ */
+size_t TextReader::feed(const char* a, const char* b)
+{
+    if(a==b) {
+	eof_ = true;
+	return 0;
+    }
+
+    if(a_!=b_ && a_!=p_) {
+	std::copy(a_, b_, p_);
+    }
+    b_ -= (a_-p_);
+    a_ = p_;
+
+    const size_t n = std::min(b-a, q_-b_);
+    b_ = std::copy(a, a+n, b_);
+    return n;
+}
+
+
 size_t TextReader::read(char*& begin, char*& end)
 {
     char* const c = std::search(a_, b_,
@@ -89,8 +122,8 @@ size_t TextReader::read(char*& begin, char*& end)
 	     * an endline marker.
 	     *
 	     * XXX Slight loophole here -- eof_ may be a false one
-	     * caused by an overlong line. But we shouldn't have
-	     * kept reading in that case.
+	     * caused by an overlong line (without fragments). But we
+	     * shouldn't have kept reading in that case.
 	     */
 	    begin = a_;
 	    end = b_;
@@ -100,10 +133,16 @@ size_t TextReader::read(char*& begin, char*& end)
 
 	if(a_==p_ && b_==q_) {
 	    /* The buffer is full and yet there is no endline, i.e.  we've
-	     * found a line that's too long to read.  We could read it as
-	     * a fragment, but for now choose the other option: treat it
-	     * as an error.
+	     * found a line that's too long to read.  Either read it as
+	     * a fragment (leaving what may be the start of an endline),
+	     * or treat it as an error.
 	     */
+	    if(fragments_) {
+		begin = a_;
+		end = b_ - (endline_.size() - 1);
+		a_ = end;
+		return (end-begin);
+	    }
 	    eof_ = true;
 	}
 
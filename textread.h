@@ -24,7 +24,15 @@ namespace sockutil {
      *
      * feed() calls recv(2) exactly once (so that it can be used with
      * select(2) and blocking sockets). It may read some stream data
-     * or set eof().
+     * or set eof(). It returns false when there's nothing more to read
+     * for now (EAGAIN or EOF), so with an edge-triggered epoll(7) it
+     * should be called, with read()s in between, until it does. It
+     * also returns false, without reading, if the buffer is full
+     * because nothing has been read() from it.
+     *
+     * Or the data can be read by someone else, and fed in as
+     * [a, b). As much of it as fits is consumed; feeding nothing
+     * sets eof().
      *
      * After feed(), one of the read() functions should be called
      * repeatedly until it returns 0 or the empty string,
@@ -32,7 +40,10 @@ namespace sockutil {
      * possibly the last one on the stream.  Strings longer than the
      * fixed-size internal buffer aren't supported: if one comes it
      * will look like EOF. (Most protocols specify a minimum line length
-     * which you have to support.)
+     * which you have to support.) Unless 'fragments' is set; then
+     * it's returned in pieces as long as the buffer, with only the
+     * last one ending with the endline. Such a piece never ends with
+     * part of an endline.
      *
      * Whenever eof() is set, there is no point in calling feed()
      * again, but there may be lines left to read() from the buffer.
@@ -43,11 +54,12 @@ namespace sockutil {
      */
     class TextReader {
     public:
-	explicit TextReader(const std::string& endline);
+	explicit TextReader(const std::string& endline, bool fragments = false);
 	TextReader(const TextReader&);
 	TextReader& operator= (const TextReader&);
 
-	void feed(int fd);
+	bool feed(int fd);
+	size_t feed(const char* a, const char* b);
 
 	size_t read(char*& begin, char*& end);
 	std::string read();
@@ -60,6 +72,7 @@ namespace sockutil {
 	TextReader();
 
 	std::string endline_;
+	bool fragments_;
 	char buf[8000];
 	char* const p_;
 	char* const q_;
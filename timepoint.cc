@@ -23,7 +23,8 @@ void time_of_day(char* buf, size_t len, const Timepoint t)
     const time_t tt = std::chrono::system_clock::to_time_t(t);
     const unsigned ms = t.time_since_epoch().count() % 1000;
 
-    const struct tm tm = *std::localtime(&tt);
+    struct tm tm;
+    localtime_r(&tt, &tm);
     std::snprintf(buf, len, "%02d:%02d:%02d.%03u",
 		  tm.tm_hour, tm.tm_min, tm.tm_sec, ms);
 
@@ -0,0 +1,166 @@
+/* Copyright (c) 2024 Jrgen Grahn
+ * All rights reserved.
+ *
+ */
+#include "timerwheel.h"
+
+#include <algorithm>
+
+TimerWheel::TimerWheel(Clock::time_point t0, Duration resolution, unsigned slots)
+    : t0 {t0},
+      resolution {resolution},
+      slots(slots, nil)
+{}
+
+/**
+ * The first tick at or after 't'.
+ */
+TimerWheel::Tick TimerWheel::tick_of(Clock::time_point t) const
+{
+    if (t <= t0) return 0;
+    const auto d = std::chrono::ceil<Duration>(t - t0);
+    return (d.count() + resolution.count() - 1) / resolution.count();
+}
+
+/**
+ * Call f() once, at the first advance() to 't' or later.
+ */
+TimerWheel::Timer TimerWheel::add(Clock::time_point t, std::function<void()> f)
+{
+    unsigned i = free;
+    if (i==nil) {
+	i = nodes.size();
+	nodes.emplace_back();
+    }
+    else {
+	free = nodes[i].next;
+    }
+
+    Node& node = nodes[i];
+    node.f = std::move(f);
+    node.tick = std::max(tick_of(t), now + 1);
+    link(i);
+    n++;
+
+    return {i, node.gen};
+}
+
+/**
+ * Cancel a timer, unless it has fired or been cancelled already.
+ * Either way the handle is reset. Returns true if something was
+ * cancelled.
+ */
+bool TimerWheel::cancel(Timer& timer)
+{
+    const Timer t = timer;
+    timer = {};
+    if (!t || t.index >= nodes.size()) return false;
+    Node& node = nodes[t.index];
+    if (node.gen != t.gen || !node.f) return false;
+
+    if (node.linked) unlink(t.index);
+    release(t.index);
+    return true;
+}
+
+/**
+ * Move the clock forward to 't', firing the timers which expire on
+ * the way, in order of expiry. The timers may add and cancel other
+ * timers.
+ */
+void TimerWheel::advance(Clock::time_point t)
+{
+    Tick target = 0;
+    if (t > t0) target = (t - t0) / resolution;
+
+    while (now < target) {
+	if (!n) {
+	    now = target;
+	    break;
+	}
+
+	now++;
+	std::vector<Timer> due;
+	unsigned i = slots[now % slots.size()];
+	while (i != nil) {
+	    Node& node = nodes[i];
+	    const unsigned next = node.next;
+	    if (node.tick <= now) {
+		unlink(i);
+		node.linked = false;
+		due.push_back({i, node.gen});
+	    }
+	    i = next;
+	}
+
+	/* The slot is newest-first, but ties should fire in the
+	 * order they were added.
+	 */
+	std::reverse(begin(due), end(due));
+
+	for (const Timer& t : due) {
+	    Node& node = nodes[t.index];
+	    if (node.gen != t.gen) continue;
+	    auto f = std::move(node.f);
+	    release(t.index);
+	    f();
+	}
+    }
+}
+
+/**
+ * A point in time before which nothing can expire. Not necessarily
+ * one where something does, but advancing to it is cheap.
+ */
+TimerWheel::Clock::time_point TimerWheel::next() const
+{
+    const Tick lap = slots.size();
+    if (!n) return t0 + (now + lap) * resolution;
+
+    for (Tick k = std::max(hint, now + 1); k <= now + lap; k++) {
+	if (slots[k % lap] != nil) {
+	    hint = k;
+	    return t0 + k * resolution;
+	}
+    }
+    return t0 + (now + lap) * resolution;
+}
+
+void TimerWheel::link(unsigned i)
+{
+    Node& node = nodes[i];
+    unsigned& head = slots[node.tick % slots.size()];
+    hint = std::min(hint, node.tick);
+    node.linked = true;
+    node.prev = nil;
+    node.next = head;
+    if (head != nil) nodes[head].prev = i;
+    head = i;
+}
+
+void TimerWheel::unlink(unsigned i)
+{
+    Node& node = nodes[i];
+    if (node.prev != nil) {
+	nodes[node.prev].next = node.next;
+    }
+    else {
+	slots[node.tick % slots.size()] = node.next;
+    }
+    if (node.next != nil) nodes[node.next].prev = node.prev;
+}
+
+/**
+ * Put an unlinked node on the free list, and invalidate handles to
+ * it.
+ */
+void TimerWheel::release(unsigned i)
+{
+    Node& node = nodes[i];
+    node.f = nullptr;
+    node.linked = false;
+    node.gen++;
+    node.next = free;
+    free = i;
+    n--;
+}
@@ -0,0 +1,89 @@
+/* Copyright (c) 2024 Jrgen Grahn
+ * All rights reserved.
+ *
+ */
+#ifndef DJCL_TIMERWHEEL_H
+#define DJCL_TIMERWHEEL_H
+
+#include <chrono>
+#include <functional>
+#include <vector>
+#include <cstdint>
+
+/**
+ * A hashed timer wheel, after Varghese & Lauck: time is divided into
+ * ticks, and a timer is hashed into one of a fixed number of slots by
+ * the tick when it expires. Adding and cancelling a timer are O(1),
+ * and so is advancing the clock by a tick, not counting the timers
+ * which expire (or which sit in the same slot, waiting for a later
+ * lap).
+ *
+ * Timers fire no earlier than requested, and at most one tick late
+ * (or later, if advance() isn't called often enough).
+ *
+ * The wheel doesn't look at any clock itself; the user supplies the
+ * time. That's what makes it testable.
+ */
+class TimerWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Duration = std::chrono::milliseconds;
+
+    /**
+     * A handle for cancelling a timer. A default-constructed one
+     * refers to no timer, and so does one whose timer has fired or
+     * been cancelled.
+     */
+    struct Timer {
+	unsigned index = ~0u;
+	unsigned gen = 0;
+	explicit operator bool () const { return index != ~0u; }
+    };
+
+    TimerWheel(Clock::time_point t0, Duration resolution, unsigned slots);
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator= (const TimerWheel&) = delete;
+
+    Timer add(Clock::time_point t, std::function<void()> f);
+    bool cancel(Timer& timer);
+
+    void advance(Clock::time_point t);
+
+    bool empty() const { return !n; }
+    size_t size() const { return n; }
+    Clock::time_point next() const;
+
+private:
+    using Tick = std::uint64_t;
+    static constexpr unsigned nil = ~0u;
+
+    const Clock::time_point t0;
+    const Duration resolution;
+    Tick now = 0;
+    size_t n = 0;
+
+    struct Node {
+	std::function<void()> f;
+	Tick tick;
+	unsigned gen = 0;
+	bool linked = false;
+	unsigned prev;
+	unsigned next;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<unsigned> slots;
+    unsigned free = nil;
+
+    /* No timer expires before this tick, so next() needn't look at
+     * the slots before it.
+     */
+    mutable Tick hint = 0;
+
+    Tick tick_of(Clock::time_point t) const;
+    void link(unsigned i);
+    void unlink(unsigned i);
+    void release(unsigned i);
+};
+
+#endif
@@ -0,0 +1,255 @@
+/* Copyright (c) 2024 Jrgen Grahn
+ * All rights reserved.
+ *
+ */
+#include "uring.h"
+
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <errno.h>
+
+namespace {
+
+    /* Not in older <linux/io_uring.h>; the opcode after
+     * IORING_OP_SENDMSG_ZC, since Linux 6.7.
+     */
+    constexpr unsigned op_read_multishot = IORING_OP_SENDMSG_ZC + 1;
+
+    constexpr unsigned short bgid = 0;
+
+    template <class T>
+    T* at(void* p, size_t offset)
+    {
+	return reinterpret_cast<T*>(static_cast<char*>(p) + offset);
+    }
+
+    void* map(int fd, size_t len, off_t offset)
+    {
+	void* p = mmap(nullptr, len, PROT_READ | PROT_WRITE,
+		       MAP_SHARED | MAP_POPULATE, fd, offset);
+	return p==MAP_FAILED ? nullptr : p;
+    }
+
+    /* Page-aligned memory, for sharing with the kernel.
+     */
+    void* anon(size_t len)
+    {
+	void* p = mmap(nullptr, len, PROT_READ | PROT_WRITE,
+		       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	return p==MAP_FAILED ? nullptr : p;
+    }
+
+    int reg(int fd, unsigned op, void* arg, unsigned n)
+    {
+	return syscall(__NR_io_uring_register, fd, op, arg, n);
+    }
+
+    bool supported(int fd, unsigned op)
+    {
+	const unsigned nops = 256;
+	std::vector<unsigned char> v(sizeof(io_uring_probe) +
+				     nops * sizeof(io_uring_probe_op));
+	auto probe = reinterpret_cast<io_uring_probe*>(v.data());
+	if (reg(fd, IORING_REGISTER_PROBE, probe, nops) == -1) return false;
+	if (op > probe->last_op) return false;
+	return probe->ops[op].flags & IO_URING_OP_SUPPORTED;
+    }
+}
+
+/**
+ * A ring with room for 'entries' submissions (and more completions),
+ * and 'nbuf' buffers of 'bufsize' octets each for reading into;
+ * nbuf must be a power of two.
+ */
+Uring::Uring(unsigned entries, unsigned nbuf, unsigned bufsize)
+    : nbuf {nbuf},
+      bufsize {bufsize}
+{
+    if (!setup(entries)) teardown();
+}
+
+Uring::~Uring()
+{
+    teardown();
+}
+
+bool Uring::setup(unsigned entries)
+{
+    io_uring_params p {};
+    p.flags = IORING_SETUP_CQSIZE;
+    p.cq_entries = 8 * entries;
+    fd = syscall(__NR_io_uring_setup, entries, &p);
+    if (fd==-1) return false;
+
+    const unsigned need = IORING_FEAT_SINGLE_MMAP
+			| IORING_FEAT_NODROP
+			| IORING_FEAT_EXT_ARG;
+    if ((p.features & need) != need) return false;
+    if (!supported(fd, op_read_multishot)) return false;
+
+    sq.len = std::max(p.sq_off.array + p.sq_entries * sizeof(unsigned),
+		      p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe));
+    sq.p = map(fd, sq.len, IORING_OFF_SQ_RING);
+    if (!sq.p) return false;
+
+    sqe_ring.len = p.sq_entries * sizeof(io_uring_sqe);
+    sqe_ring.p = map(fd, sqe_ring.len, IORING_OFF_SQES);
+    if (!sqe_ring.p) return false;
+
+    sq_head = at<unsigned>(sq.p, p.sq_off.head);
+    sq_tail = at<unsigned>(sq.p, p.sq_off.tail);
+    sq_mask = *at<unsigned>(sq.p, p.sq_off.ring_mask);
+    sq_entries = p.sq_entries;
+    sqes = static_cast<io_uring_sqe*>(sqe_ring.p);
+
+    unsigned* const array = at<unsigned>(sq.p, p.sq_off.array);
+    for (unsigned i = 0; i < sq_entries; i++) array[i] = i;
+
+    cq_head = at<unsigned>(sq.p, p.cq_off.head);
+    cq_tail = at<unsigned>(sq.p, p.cq_off.tail);
+    cq_mask = *at<unsigned>(sq.p, p.cq_off.ring_mask);
+    cqes = at<io_uring_cqe>(sq.p, p.cq_off.cqes);
+
+    /* The provided buffers, and the ring we hand them to the
+     * kernel through.
+     */
+    buf_ring.len = nbuf * sizeof(io_uring_buf) + nbuf * bufsize;
+    buf_ring.p = anon(buf_ring.len);
+    if (!buf_ring.p) return false;
+    br = static_cast<io_uring_buf*>(buf_ring.p);
+    bufs = at<char>(buf_ring.p, nbuf * sizeof(io_uring_buf));
+
+    io_uring_buf_reg r {};
+    r.ring_addr = reinterpret_cast<std::uint64_t>(br);
+    r.ring_entries = nbuf;
+    r.bgid = bgid;
+    if (reg(fd, IORING_REGISTER_PBUF_RING, &r, 1) == -1) return false;
+
+    for (unsigned i = 0; i < nbuf; i++) recycle(i);
+
+    return true;
+}
+
+void Uring::teardown()
+{
+    for (Ring* r : {&sq, &sqe_ring, &buf_ring}) {
+	if (r->p) munmap(r->p, r->len);
+	r->p = nullptr;
+    }
+    if (fd != -1) close(fd);
+    fd = -1;
+}
+
+/**
+ * The next free submission queue entry, cleared. If the queue is
+ * full, what's in it is submitted first.
+ */
+io_uring_sqe& Uring::sqe()
+{
+    const unsigned tail = *sq_tail;
+    if (tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) == sq_entries) {
+	enter(pending, 0, 0, nullptr, 0);
+    }
+
+    io_uring_sqe& e = sqes[tail & sq_mask];
+    std::memset(&e, 0, sizeof e);
+    __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+    pending++;
+    return e;
+}
+
+int Uring::enter(unsigned to_submit, unsigned min_complete, unsigned flags,
+		 const void* arg, size_t argsz)
+{
+    const int n = syscall(__NR_io_uring_enter, fd, to_submit, min_complete,
+			  flags, arg, argsz);
+    if (n > 0) {
+	pending -= n;
+	nsubmitted += n;
+    }
+    return n;
+}
+
+/**
+ * Poll 'fd' for 'events' (POLLIN, POLLOUT, ...) once, or until
+ * cancelled.
+ */
+void Uring::poll(int fd, unsigned events, bool multishot, std::uint64_t tag)
+{
+    io_uring_sqe& e = sqe();
+    e.opcode = IORING_OP_POLL_ADD;
+    e.fd = fd;
+    e.poll32_events = events;
+    e.len = multishot ? IORING_POLL_ADD_MULTI : 0;
+    e.user_data = tag;
+}
+
+/**
+ * Read from 'fd' into provided buffers, until EOF, error, running
+ * out of buffers (-ENOBUFS), or cancelled.
+ */
+void Uring::read(int fd, std::uint64_t tag)
+{
+    io_uring_sqe& e = sqe();
+    e.opcode = op_read_multishot;
+    e.fd = fd;
+    e.flags = IOSQE_BUFFER_SELECT;
+    e.buf_group = bgid;
+    e.user_data = tag;
+}
+
+/**
+ * Cancel the request(s) tagged 'tag'. The cancellation itself
+ * completes with tag 0.
+ */
+void Uring::cancel(std::uint64_t tag)
+{
+    io_uring_sqe& e = sqe();
+    e.opcode = IORING_OP_ASYNC_CANCEL;
+    e.fd = -1;
+    e.addr = tag;
+    e.cancel_flags = IORING_ASYNC_CANCEL_ALL;
+    e.user_data = 0;
+}
+
+/**
+ * Submit what's queued, and wait for at least one completion, or
+ * until 'timeout' ms have passed (or forever, if it's negative).
+ * Returns -1 with errno set on error, where ETIME and EINTR aren't
+ * really errors.
+ */
+int Uring::wait(int timeout)
+{
+    __kernel_timespec ts {};
+    ts.tv_sec = timeout / 1000;
+    ts.tv_nsec = (timeout % 1000) * 1000000L;
+
+    io_uring_getevents_arg arg {};
+    if (timeout >= 0) arg.ts = reinterpret_cast<std::uint64_t>(&ts);
+
+    const unsigned flags = IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+    return enter(pending, 1, flags, &arg, sizeof arg);
+}
+
+/**
+ * Give buffer 'bid' back to the kernel, once whatever was read into
+ * it has been taken care of.
+ */
+void Uring::recycle(unsigned bid)
+{
+    /* Not using io_uring_buf_ring::bufs; in C++ the flexible array
+     * ends up at the wrong offset. The tail overlays bufs[0].resv.
+     */
+    unsigned short* const ptail = &br[0].resv;
+    const unsigned short tail = *ptail;
+    io_uring_buf& b = br[tail & (nbuf - 1)];
+    b.addr = reinterpret_cast<std::uint64_t>(bufs + bid * bufsize);
+    b.len = bufsize;
+    b.bid = bid;
+    __atomic_store_n(ptail, tail + 1, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,109 @@
+/* Copyright (c) 2024 Jrgen Grahn
+ * All rights reserved.
+ *
+ */
+#ifndef DJCL_URING_H
+#define DJCL_URING_H
+
+#include <cstdint>
+#include <cstddef>
+
+#include <linux/io_uring.h>
+
+/**
+ * A bare-bones io_uring(7) instance, on top of the raw system calls
+ * rather than liburing. Just what Spider needs: polling, multishot
+ * reads into a ring of provided buffers, and cancellation.
+ *
+ * Requests are queued, and submitted in one go by the next wait().
+ * Each request has a 64-bit tag, which comes back in its
+ * completions.
+ *
+ * If the kernel lacks io_uring, or the features we need (Linux 6.7
+ * or so), or if io_uring has been disabled, the object is simply not
+ * valid().
+ */
+class Uring {
+public:
+    Uring(unsigned entries, unsigned nbuf, unsigned bufsize);
+    ~Uring();
+    Uring(const Uring&) = delete;
+    Uring& operator= (const Uring&) = delete;
+
+    bool valid() const { return fd != -1; }
+
+    void poll(int fd, unsigned events, bool multishot, std::uint64_t tag);
+    void read(int fd, std::uint64_t tag);
+    void cancel(std::uint64_t tag);
+
+    int wait(int timeout);
+
+    template <class F> unsigned reap(F f);
+
+    const char* buffer(unsigned bid) const { return bufs + bid * bufsize; }
+    void recycle(unsigned bid);
+
+    unsigned long submitted() const { return nsubmitted; }
+
+private:
+    int fd = -1;
+
+    struct Ring {
+	void* p = nullptr;
+	size_t len = 0;
+    };
+
+    /* The submission queue, and the completion queue in the same
+     * mapping.
+     */
+    Ring sq;
+    Ring sqe_ring;
+    Ring buf_ring;
+
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned sq_mask;
+    unsigned sq_entries;
+    io_uring_sqe* sqes;
+
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned cq_mask;
+    io_uring_cqe* cqes;
+
+    io_uring_buf* br = nullptr;
+    unsigned nbuf;
+    unsigned bufsize;
+    char* bufs = nullptr;
+
+    unsigned pending = 0;
+    unsigned long nsubmitted = 0;
+
+    io_uring_sqe& sqe();
+    int enter(unsigned to_submit, unsigned min_complete, unsigned flags,
+	      const void* arg, size_t argsz);
+    bool setup(unsigned entries);
+    void teardown();
+};
+
+/**
+ * Call f(cqe) for each completion, and consume them. Returns the
+ * number of completions.
+ */
+template <class F>
+unsigned Uring::reap(F f)
+{
+    unsigned head = *cq_head;
+    const unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+    unsigned n = 0;
+    while (head != tail) {
+	const io_uring_cqe cqe = cqes[head & cq_mask];
+	head++;
+	__atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+	f(cqe);
+	n++;
+    }
+    return n;
+}
+
+#endif